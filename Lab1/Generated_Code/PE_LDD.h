@@ -61,6 +61,7 @@
 #include "PE_Types.h"
 #include "PE_Error.h"
 #include "PE_Const.h"
+#include "INT_UART2_RX_TX.h"
 
 
 /*
@@ -11,6 +11,7 @@
  */
 
 #include "FIFO.h"
+#include "Cpu.h"
 
 void FIFO_Init(TFIFO * const FIFO)
 {
@@ -29,6 +30,9 @@ BOOL FIFO_Put(TFIFO * const FIFO, const uint8_t data)
     return bFALSE; // FIFO full error: Not able to Put anymore data.
   }
 
+  // Start critical region to ensure integrity of Buffer
+  EnterCritical();
+
   // Append data to the buffer
   FIFO->Buffer[FIFO->End] = data;
   FIFO->NbBytes++; // Maintain number of bytes in the buffer
@@ -36,6 +40,8 @@ BOOL FIFO_Put(TFIFO * const FIFO, const uint8_t data)
   // Increment End index, wrapping to the front if necessary
   FIFO->End = (FIFO->End + 1) % FIFO_SIZE;
 
+  ExitCritical();
+
   return bTRUE;
 }
 
@@ -47,6 +53,9 @@ BOOL FIFO_Get(TFIFO * const FIFO, uint8_t * const dataPtr)
     return bFALSE; // FIFO empty error: Nothing to Get.
   }
 
+  // Start critical region to ensure integrity of Buffer
+  EnterCritical();
+
   // Get data from the buffer
   *dataPtr = FIFO->Buffer[FIFO->Start];
   FIFO->NbBytes--; // Maintain number of bytes in the buffer
@@ -54,5 +63,7 @@ BOOL FIFO_Get(TFIFO * const FIFO, uint8_t * const dataPtr)
   // Increment Start index, wrapping to the front if necessary
   FIFO->Start = (FIFO->Start + 1) % FIFO_SIZE;
 
+  ExitCritical();
+
   return bTRUE;
 }
@@ -13,10 +13,13 @@
 #include "UART.h"
 #include "FIFO.h"
 #include "MK70F12.h"
+#include "Cpu.h"
 
 #define UART2_RDRF (UART2_S1 & UART_S1_RDRF_MASK) // UART2 Receive Data Register Full Flag Mask
 #define UART2_TDRE (UART2_S1 & UART_S1_TDRE_MASK) // UART2 Transmit Data Register Empty Flag Mask
 
+static volatile uint32_t RxTimestamp; /*!< DWT cycle count at which the last byte was received */
+
 static TFIFO  TxFIFO,  /*!< The Transmit FIFO Buffer */
               RxFIFO;  /*!< The Receive FIFO Buffer */
 
@@ -60,6 +63,9 @@ BOOL UART_Init(const uint32_t baudRate, const uint32_t moduleClk)
   // Enable Transmitting/Receiving for UART2
   UART2_C2 |= (UART_C2_TE_MASK | UART_C2_RE_MASK);
 
+  // Enable Receive Full Interrupts (Transmit Empty Interrupts are enabled by UART_OutChar when there is data to send)
+  UART2_C2 |= UART_C2_RIE_MASK;
+
   return bTRUE;
 }
 
@@ -72,25 +78,65 @@ BOOL UART_InChar(uint8_t * const dataPtr)
 BOOL UART_OutChar(const uint8_t data)
 {
   // Add data to the transmit FIFO buffer
-  return FIFO_Put(&TxFIFO, data);
+  if (FIFO_Put(&TxFIFO, data))
+  {
+    // Enable Transmit Empty Interrupts so the ISR sends the data
+    UART2_C2 |= UART_C2_TIE_MASK;
+    return bTRUE;
+  }
+
+  // Transmit FIFO buffer full
+  return bFALSE;
+}
+
+void UART_WaitForData(void)
+{
+  // Disable interrupts so a byte received between the check and the WFI cannot be missed
+  __DI();
+
+  // Sleep until the next interrupt if there is nothing in the receive FIFO buffer
+  // (a pending interrupt still wakes the core while interrupts are disabled)
+  if (RxFIFO.NbBytes == 0)
+  {
+    PE_WFI();
+  }
+
+  // Re-enable interrupts, letting the interrupt that woke the core run
+  __EI();
 }
 
-void UART_Poll(void)
+uint32_t UART_RxTimestamp(void)
+{
+  return RxTimestamp;
+}
+
+void __attribute__ ((interrupt)) UART_ISR(void)
 {
   uint8_t txData;
 
   // Check if data ready to read from UART2
-  if (UART2_RDRF)
+  if ((UART2_C2 & UART_C2_RIE_MASK) && UART2_RDRF)
   {
     // Read from UART2 data register into the receive FIFO buffer
     FIFO_Put(&RxFIFO, UART2_D);
+
+    // Timestamp the byte (reads 0 unless the DWT cycle counter has been enabled)
+    RxTimestamp = DWT_CYCCNT;
   }
 
   // Check if UART2 is ready to transmit and there is data waiting in transmit FIFO buffer
-  if (UART2_TDRE && FIFO_Get(&TxFIFO, &txData))
+  if ((UART2_C2 & UART_C2_TIE_MASK) && UART2_TDRE)
   {
-    // Write to UART2 data register
-    UART2_D = txData;
+    if (FIFO_Get(&TxFIFO, &txData))
+    {
+      // Write to UART2 data register
+      UART2_D = txData;
+    }
+    else
+    {
+      // Disable Transmit Empty Interrupts
+      UART2_C2 &= ~UART_C2_TIE_MASK;
+    }
   }
 }
 
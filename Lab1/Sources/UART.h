@@ -38,11 +38,26 @@ BOOL UART_InChar(uint8_t * const dataPtr);
  */
 BOOL UART_OutChar(const uint8_t data);
 
-/*! @brief Poll the UART status register to try and receive and/or transmit one character.
+/*! @brief Sleep (WFI) until the UART has received data.
  *
+ *  Returns immediately if the receive FIFO is not empty, otherwise waits for the next interrupt.
  *  @return void
  *  @note Assumes that UART_Init has been called.
  */
-void UART_Poll(void);
+void UART_WaitForData(void);
+
+/*! @brief Get the DWT cycle count at which the last byte was received.
+ *
+ *  @return uint32_t - The value of DWT_CYCCNT when the last byte was received.
+ *  @note Only meaningful once the DWT cycle counter has been enabled.
+ */
+uint32_t UART_RxTimestamp(void);
+
+/*! @brief Interrupt service routine for the UART.
+ *
+ *  Moves received bytes into the receive FIFO and sends bytes from the transmit FIFO.
+ *  @note Assumes the transmit and receive FIFOs have been initialized.
+ */
+void __attribute__ ((interrupt)) UART_ISR(void);
 
 #endif
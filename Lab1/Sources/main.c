@@ -19,6 +19,9 @@
 const uint8_t PACKET_ACK_MASK = 1 << 7; // Command ID has bit 7 (MSB) reserved for packet acknowledgement
 const uint32_t BAUD_RATE = 38400; // Either 38400 or 115200 baud. Default is 38400.
 
+// Uncommenting the below enables the DWT cycle counter probe, whose results (IdleProbe) can be read with the debugger
+//#define IDLE_PROBE
+
 // Enum for Tower Command Packet opcodes
 enum TowerCommand
 {
@@ -27,6 +30,19 @@ enum TowerCommand
   TOWER_NUMBER = 0x0B // "Tower Number" Command
 };
 
+#ifdef IDLE_PROBE
+/*! @brief Cycle counts measured by the idle probe */
+typedef struct
+{
+  uint32_t LastLatency; /*!< Cycles from the last byte of a packet being received to its response being queued */
+  uint32_t MaxLatency; /*!< The largest LastLatency seen */
+  uint32_t AwakeCycles; /*!< Cycles spent awake, from each wakeup until the next sleep */
+  uint32_t NbWakeups; /*!< Number of times the core has woken from its idle sleep */
+} TIdleProbe;
+
+static volatile TIdleProbe IdleProbe; /*!< The idle probe results */
+#endif
+
 static uint16union_t TowerNumber; /*!< The Tower's Number */
 
 /*! @brief Send the "Tower Startup" packet
@@ -213,6 +229,27 @@ static void SendAcknowledgeIfRequired(BOOL wasSuccess)
   }
 }
 
+/*! @brief Sleeps until the UART receives more data
+ *
+ *  Also records the cycles spent awake and the number of wakeups if the idle probe is enabled.
+ */
+static void Idle(void)
+{
+#ifdef IDLE_PROBE
+  static uint32_t wakeTime; // Cycle count when the core last woke up
+
+  IdleProbe.AwakeCycles += DWT_CYCCNT - wakeTime;
+#endif
+
+  // Sleep (WFI) until the UART interrupt brings in more data
+  UART_WaitForData();
+
+#ifdef IDLE_PROBE
+  wakeTime = DWT_CYCCNT;
+  IdleProbe.NbWakeups++;
+#endif
+}
+
 /*lint -save  -e970 Disable MISRA rule (6.3) checking. */
 int main(void)
 /*lint -restore Enable MISRA rule (6.3) checking. */
@@ -227,15 +264,19 @@ int main(void)
   // Initialise the Packet Encoder/Decoder (+ UART) to the BAUD_RATE specified above and the bus clock speed from Processor Expert
   (void) Packet_Init(BAUD_RATE, CPU_BUS_CLK_HZ); // No error handling required, cannot currently fail
 
+#ifdef IDLE_PROBE
+  // Enable the DWT cycle counter (DEMCR TRCENA, then DWT_CTRL CYCCNTENA)
+  DEMCR |= (1 << 24);
+  DWT_CYCCNT = 0;
+  DWT_CTRL |= 1;
+#endif
+
   // Send startup packets as per Tower To PC Protocol
   HandleStartup();
 
   // Loop forever (embedded software never ends!)
   for (;;)
   {
-    // Poll the UART: Receive/Transmit packets into/from the FIFO buffers as required
-    UART_Poll();
-
     // Check if a valid packet can be built from the Receive Buffer
     if (Packet_Get())
     {
@@ -244,6 +285,20 @@ int main(void)
 
       // Transmit ACK/NAK packet to the PC if required
       SendAcknowledgeIfRequired(correctlyHandled);
+
+#ifdef IDLE_PROBE
+      // Measure the response latency from the packet's last byte arriving
+      IdleProbe.LastLatency = DWT_CYCCNT - UART_RxTimestamp();
+      if (IdleProbe.LastLatency > IdleProbe.MaxLatency)
+      {
+        IdleProbe.MaxLatency = IdleProbe.LastLatency;
+      }
+#endif
+    }
+    else
+    {
+      // Receive FIFO buffer drained, nothing to do until more data arrives
+      Idle();
     }
   }
 
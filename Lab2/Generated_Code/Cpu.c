@@ -330,6 +330,7 @@
 /* MODULE Cpu. */
 
 /* {Default RTOS Adapter} No RTOS includes */
+#include "INT_UART2_RX_TX.h"
 #include "PE_Types.h"
 #include "PE_Error.h"
 #include "PE_Const.h"
@@ -538,8 +539,12 @@ void PE_low_level_init(void)
   /* SMC_PMPROT: ??=0,??=0,AVLP=0,??=0,ALLS=0,??=0,AVLLS=0,??=0 */
   SMC_PMPROT = 0x00U;                  /* Setup Power mode protection register */
   /* Common initialization of the CPU registers */
+  /* NVICIP49: PRI49=0x80 */
+  NVICIP49 = NVIC_IP_PRI49(0x80);
   /* NVICIP20: PRI20=0 */
   NVICIP20 = NVIC_IP_PRI20(0x00);
+  /* NVICISER1: SETENA|=0x00020000 */
+  NVICISER1 |= NVIC_ISER_SETENA(0x00020000);
   /* Enable interrupts of the given priority level */
   Cpu_SetBASEPRI(0U);
 }
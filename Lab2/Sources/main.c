@@ -13,6 +13,7 @@
 
 // CPU module - contains low level hardware initialization routines
 #include "Cpu.h"
+#include "INT_UART2_RX_TX.h"
 #include "PE_Types.h"
 #include "PE_Error.h"
 #include "PE_Const.h"
@@ -26,6 +27,9 @@
 const uint8_t PACKET_ACK_MASK = 1 << 7; // Command ID has bit 7 (MSB) reserved for packet acknowledgement
 const uint32_t BAUD_RATE = 115200; // Either 38400 or 115200 baud. Default is 38400.
 
+// Uncommenting the below enables the DWT cycle counter probe, whose results (IdleProbe) can be read with the debugger
+//#define IDLE_PROBE
+
 // Enum for Tower Command Packet opcodes
 enum TowerCommand
 {
@@ -40,6 +44,19 @@ enum TowerCommand
 static volatile uint16union_t * NvTowerNb; /*! The Tower's Number */
 static volatile uint16union_t * NvTowerMode; /*! The Tower's Mode */
 
+#ifdef IDLE_PROBE
+/*! @brief Cycle counts measured by the idle probe */
+typedef struct
+{
+  uint32_t LastLatency; /*!< Cycles from the last byte of a packet being received to its response being queued */
+  uint32_t MaxLatency; /*!< The largest LastLatency seen */
+  uint32_t AwakeCycles; /*!< Cycles spent awake, from each wakeup until the next sleep */
+  uint32_t NbWakeups; /*!< Number of times the core has woken from its idle sleep */
+} TIdleProbe;
+
+static volatile TIdleProbe IdleProbe; /*!< The idle probe results */
+#endif
+
 /*! @brief Send the "Tower Startup" packet
  *
  * Command: 0x04
@@ -344,6 +361,27 @@ static void AllocateAndSet(volatile uint16union_t ** const addressPtr, uint16_t
   }
 }
 
+/*! @brief Sleeps until the UART receives more data
+ *
+ *  Also records the cycles spent awake and the number of wakeups if the idle probe is enabled.
+ */
+static void Idle(void)
+{
+#ifdef IDLE_PROBE
+  static uint32_t wakeTime; // Cycle count when the core last woke up
+
+  IdleProbe.AwakeCycles += DWT_CYCCNT - wakeTime;
+#endif
+
+  // Sleep (WFI) until the UART interrupt brings in more data
+  UART_WaitForData();
+
+#ifdef IDLE_PROBE
+  wakeTime = DWT_CYCCNT;
+  IdleProbe.NbWakeups++;
+#endif
+}
+
 /*! @brief The main entry point into the program
  *
  *  @return int - Hopefully never (embedded software never ends!)
@@ -367,15 +405,19 @@ int main(void)
   AllocateAndSet(&NvTowerMode, 1); // default to 1 as per spec
   AllocateAndSet(&NvTowerNb, 4718); // default to last 4 digits of student number (Jacob's) as per spec
 
+#ifdef IDLE_PROBE
+  // Enable the DWT cycle counter (DEMCR TRCENA, then DWT_CTRL CYCCNTENA)
+  DEMCR |= (1 << 24);
+  DWT_CYCCNT = 0;
+  DWT_CTRL |= 1;
+#endif
+
   // Send startup packets as per Tower To PC Protocol
   HandleStartup();
 
   // Loop forever (embedded software never ends!)
   for (;;)
   {
-    // Poll the UART: Receive/Transmit packets into/from the FIFO buffers as required
-    UART_Poll();
-
     // Check if a valid packet can be built from the Receive Buffer
     if (Packet_Get())
     {
@@ -384,6 +426,20 @@ int main(void)
 
       // Transmit ACK/NAK packet to the PC if required
       SendAcknowledgeIfRequired(correctlyHandled);
+
+#ifdef IDLE_PROBE
+      // Measure the response latency from the packet's last byte arriving
+      IdleProbe.LastLatency = DWT_CYCCNT - UART_RxTimestamp();
+      if (IdleProbe.LastLatency > IdleProbe.MaxLatency)
+      {
+        IdleProbe.MaxLatency = IdleProbe.LastLatency;
+      }
+#endif
+    }
+    else
+    {
+      // Receive FIFO buffer drained, nothing to do until more data arrives
+      Idle();
     }
   }
 
@@ -16,81 +16,46 @@
 
 TPacket Packet;
 
-static uint8_t PacketBuf[PACKET_SIZE]; /*!< Internal buffer used with packet error handling */
-static uint8_t BufNbBytes; /*!< Internal index for packet error handling */
+static uint8_t PacketBuf[PACKET_SIZE]; /*!< The last bytes received, a ring starting at BufStart, used with packet error handling */
+static uint8_t BufStart; /*!< Index of the oldest byte in the ring */
+static uint8_t BufNbBytes; /*!< Number of bytes in the ring */
+static uint8_t BufXOR; /*!< Every byte in the ring XORed together, 0 when they form a valid packet */
 
 bool Packet_Init(const uint32_t baudRate, const uint32_t moduleClk)
 {
   // Initialise the UART and receive/transmit buffers
   (void) UART_Init(baudRate, moduleClk);
 
-  // Initialise the internal buffer's index
+  // Initialise the internal ring
+  BufStart = 0;
   BufNbBytes = 0;
+  BufXOR = 0;
   return true;
 }
 
-/*! @brief Read a byte from the UART receive buffer
+/*! @brief Slide a received byte into the internal ring
  *
- *  Appends a byte to the internal packet buffer if there is
- *  packet available in the UART Receive Buffer.
+ *  Once the ring is full the oldest byte slides out, so each received byte completes the next candidate packet
+ *  with constant work, rather than shifting the buffer and recalculating the checksum on every failure.
  *
- *  @return BOOL - TRUE if a packet was read into the internal buffer.
+ *  @param data The received byte.
  */
-static bool ReadNextByte(void)
+static void SlideIn(const uint8_t data)
 {
-  uint8_t data;
-
-  // Check if there is a byte in the receive buffer
-  if (UART_InChar(&data))
+  if (BufNbBytes == PACKET_SIZE)
   {
-    // Append the internal buffer with the received byte
-    PacketBuf[BufNbBytes] = data;
-    BufNbBytes++;
-    return true;
+    // The oldest byte leaves the running XOR, and the new byte takes its place
+    BufXOR ^= PacketBuf[BufStart];
+    PacketBuf[BufStart] = data;
+    BufStart = (BufStart + 1) % PACKET_SIZE;
   }
-
-  // No bytes in the receive buffer
-  return false;
-}
-
-/*! @brief Checks if the candidate packet in the buffer is valid
- *
- *  Verifies the candidate packet in the buffer by comparing the checksum byte
- *  against one calculated for the initial 4 bytes of the packet
- *
- *  @return BOOL - TRUE if the candidate packet is successful.
- */
-static bool IsChecksumValid(void)
-{
-  uint8_t checksum = PacketBuf[0]; // set Initial Value (byte 1) for checksum calculation
-  uint8_t i;
-
-  // Perform checksum calculation
-  for (i = 1; i < (PACKET_SIZE - 1); i++)
+  else
   {
-    checksum ^= PacketBuf[i];
-  }
-
-  // Check if calculated checksum == received checksum
-  return checksum == PacketBuf[PACKET_SIZE - 1];
-}
-
-/*! @brief Discard First Byte In Internal Buffer
-*
-* Drops the first byte in the internal error handling/recovery buffer and maintains buffer state
-*
-*/
-static void ShiftBuffer(void)
-{
-  uint8_t i;
-
-  // Shift the internal buffer 1 to the left (discard first byte)
-  for (i = 1; i < PACKET_SIZE; i++)
-  {
-    PacketBuf[i - 1] = PacketBuf[i];
+    PacketBuf[(BufStart + BufNbBytes) % PACKET_SIZE] = data;
+    BufNbBytes++;
   }
 
-  BufNbBytes--;
+  BufXOR ^= data;
 }
 
 /*! @brief Set Packet Bytes and Reset Internal Buffers
@@ -100,37 +65,34 @@ static void ShiftBuffer(void)
 */
 static void SetValuesAndResetBuffer(void)
 {
-  // Set the packet bytes from the buffer used during the error checking/handling phase
-  Packet_Command = PacketBuf[0];
-  Packet_Parameter1 = PacketBuf[1];
-  Packet_Parameter2 = PacketBuf[2];
-  Packet_Parameter3 = PacketBuf[3];
-
-  // Reset the error handling buffer index
+  // Set the packet bytes from the ring used during the error checking/handling phase
+  Packet_Command = PacketBuf[BufStart];
+  Packet_Parameter1 = PacketBuf[(BufStart + 1) % PACKET_SIZE];
+  Packet_Parameter2 = PacketBuf[(BufStart + 2) % PACKET_SIZE];
+  Packet_Parameter3 = PacketBuf[(BufStart + 3) % PACKET_SIZE];
+
+  // Empty the ring
+  BufStart = 0;
   BufNbBytes = 0;
+  BufXOR = 0;
 }
 
 bool Packet_Get(void)
 {
+  uint8_t data;
+
   // Continuously receive bytes until a valid packet is formed or the receive buffer is empty
-  while (ReadNextByte())
+  while (UART_InChar(&data))
   {
-    // Check if the internal buffer has enough bytes for a packet
-    if (BufNbBytes >= PACKET_SIZE)
+    SlideIn(data);
+
+    // The checksum is the XOR of the other 4 bytes, so the 5 bytes of a valid packet XOR to 0.
+    // Otherwise the oldest byte is discarded by the next SlideIn, trying the next alignment
+    if (BufNbBytes == PACKET_SIZE && BufXOR == 0)
     {
-      // Check if the candidate (formed) packet is valid
-      if (IsChecksumValid())
-      {
-        // Set the Packet bytes and reset internal error handling/recovery state
-        SetValuesAndResetBuffer();
-        return true;
-      }
-      else
-      {
-        // Candidate packet was invalid
-        // Attempt error recovery by discarding first byte (in preparation for reading another byte)
-        ShiftBuffer();
-      }
+      // Set the Packet bytes and reset internal error handling/recovery state
+      SetValuesAndResetBuffer();
+      return true;
     }
   }
 
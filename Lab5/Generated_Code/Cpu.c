@@ -336,6 +336,7 @@
 #include "INT_FTM0.h"
 #include "INT_PendableSrvReq.h"
 #include "INT_SysTick.h"
+#include "INT_DMA1_DMA17.h"
 #include "PE_Types.h"
 #include "PE_Error.h"
 #include "PE_Const.h"
@@ -555,6 +556,10 @@ void PE_low_level_init(void)
   NVICIP62 = NVIC_IP_PRI62(0x80);
   /* NVICIP20: PRI20=0 */
   NVICIP20 = NVIC_IP_PRI20(0x00);
+  /* NVICIP1: PRI1=0x80 */
+  NVICIP1 = NVIC_IP_PRI1(0x80);
+  /* NVICISER0: SETENA|=0x02 */
+  NVICISER0 |= NVIC_ISER_SETENA(0x02);
   /* NVICISER1: SETENA|=0x40020000 */
   NVICISER1 |= NVIC_ISER_SETENA(0x40020000);
   /* NVICISER2: SETENA|=0x18 */
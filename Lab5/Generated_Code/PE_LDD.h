@@ -67,6 +67,7 @@
 #include "INT_FTM0.h"
 #include "INT_PendableSrvReq.h"
 #include "INT_SysTick.h"
+#include "INT_DMA1_DMA17.h"
 
 
 /*
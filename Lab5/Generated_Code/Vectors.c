@@ -61,6 +61,7 @@
   #include "INT_FTM0.h"
   #include "INT_PendableSrvReq.h"
   #include "INT_SysTick.h"
+  #include "INT_DMA1_DMA17.h"
   #include "Events.h"
 
 
@@ -97,7 +98,7 @@
     (tIsrFunc)&OS_ContextSwitchISR,    /* 0x0E  0x00000038   8   ivINT_PendableSrvReq           used by PE */
     (tIsrFunc)&OS_SysTickISR,          /* 0x0F  0x0000003C   8   ivINT_SysTick                  used by PE */
     (tIsrFunc)&Cpu_Interrupt,          /* 0x10  0x00000040   -   ivINT_DMA0_DMA16               unused by PE */
-    (tIsrFunc)&Cpu_Interrupt,          /* 0x11  0x00000044   -   ivINT_DMA1_DMA17               unused by PE */
+    (tIsrFunc)&UART_RxDMA_ISR,         /* 0x11  0x00000044   8   ivINT_DMA1_DMA17               used by PE */
     (tIsrFunc)&Cpu_Interrupt,          /* 0x12  0x00000048   -   ivINT_DMA2_DMA18               unused by PE */
     (tIsrFunc)&Cpu_Interrupt,          /* 0x13  0x0000004C   -   ivINT_DMA3_DMA19               unused by PE */
     (tIsrFunc)&Cpu_Interrupt,          /* 0x14  0x00000050   -   ivINT_DMA4_DMA20               unused by PE */
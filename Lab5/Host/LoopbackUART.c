@@ -0,0 +1,194 @@
+/*! @file
+ *
+ *  @brief A UART for the host that receives everything it transmits, for running the packet module on Linux.
+ *
+ *  This contains the parts of UART.h the packet module uses, built on the same FIFOs as UART.c.
+ *
+ *  @author Group 13, Jacob Dunk (11654718) & Brenton Smith (11380654)
+ *  @date 2016-11-14
+ */
+
+#include "LoopbackUART.h"
+#include "PE_Types.h"
+#include <string.h>
+
+// The same capacities as UART.c
+#define LOOPBACK_TX_NB_SLOTS 8
+#define LOOPBACK_RX_FIFO_SIZE 256
+
+// Modelled cost of the interrupt that moves a message, so the ISR statistics vary with the message sizes
+#define LOOPBACK_ISR_CYCLES 60
+#define LOOPBACK_ISR_CYCLES_PER_BYTE 4
+
+FIFO_DEFINE(LoopbackFIFO, uint8_t, LOOPBACK_RX_FIFO_SIZE, FIFO_WINDOW_SIZE)
+
+struct UARTInstance
+{
+  TSlotFIFO TxFIFOs[UART_NB_TX_CLASSES];                        /*!< Whole messages, moved to RxFIFO as soon as committed */
+  TFIFOSlot TxSlots[UART_NB_TX_CLASSES][LOOPBACK_TX_NB_SLOTS];  /*!< The storage for the transmit FIFOs */
+  TLoopbackFIFO RxFIFO;                                         /*!< The bytes received */
+  TLoopbackRefill Refill;                                       /*!< Transmits more when a receiver runs out, or NULL */
+  void * RefillContext;                                         /*!< Passed to Refill */
+  uint32_t ErrorThreshold;                                      /*!< A byte is corrupted when the next random number is below this */
+  uint32_t Random;                                              /*!< The xorshift state of the corruption */
+  uint32_t NbCorrupted;                                         /*!< Bytes corrupted since UART_Init */
+  TUARTStatistics Statistics;                                   /*!< The link statistics, each message moved counting as an interrupt */
+};
+
+TUART UART_Port2;
+
+/*! @brief Gets the next number of the xorshift generator.
+ *
+ *  @param statePtr A pointer to the non-zero generator state.
+ *  @return uint32_t - A pseudorandom number.
+ */
+static uint32_t NextRandom(uint32_t * const statePtr)
+{
+  uint32_t x = *statePtr;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *statePtr = x;
+  return x;
+}
+
+bool UART_Init(TUART * const uart, const uint32_t baudRate, const uint32_t moduleClk)
+{
+  TUARTTxClass txClass;
+
+  (void) baudRate;
+  (void) moduleClk;
+
+  for (txClass = UART_TX_CONTROL; txClass < UART_NB_TX_CLASSES; txClass++)
+    FIFO_SlotInit(&uart->TxFIFOs[txClass], uart->TxSlots[txClass], LOOPBACK_TX_NB_SLOTS);
+
+  LoopbackFIFO_Init(&uart->RxFIFO);
+  uart->Refill = NULL;
+  uart->RefillContext = NULL;
+  Loopback_SetErrorRate(uart, 0.0, 1);
+  uart->NbCorrupted = 0;
+  memset(&uart->Statistics, 0, sizeof(uart->Statistics));
+  uart->Statistics.MinISRCycles = UINT32_MAX;
+  return true;
+}
+
+void Loopback_SetRefill(TUART * const uart, const TLoopbackRefill refill, void * const context)
+{
+  uart->Refill = refill;
+  uart->RefillContext = context;
+}
+
+void Loopback_SetErrorRate(TUART * const uart, const double byteErrorRate, const uint32_t seed)
+{
+  uart->ErrorThreshold = (byteErrorRate >= 1.0) ? UINT32_MAX : (uint32_t)(byteErrorRate * 4294967296.0);
+  uart->Random = (seed == 0) ? 1 : seed;
+}
+
+uint32_t Loopback_NbCorrupted(TUART * const uart)
+{
+  return uart->NbCorrupted;
+}
+
+void Loopback_Clear(TUART * const uart)
+{
+  LoopbackFIFO_Consume(&uart->RxFIFO, LoopbackFIFO_NbElements(&uart->RxFIFO));
+}
+
+const uint8_t * UART_InPeek(TUART * const uart, const uint16_t nbBytes)
+{
+  // Nothing else transmits while the receiver waits, so transmit more from here
+  while (LoopbackFIFO_NbElements(&uart->RxFIFO) < nbBytes)
+  {
+    const uint16_t nbBefore = LoopbackFIFO_NbElements(&uart->RxFIFO);
+
+    if (uart->Refill)
+      uart->Refill(uart->RefillContext);
+
+    // The receiver would block forever
+    if (LoopbackFIFO_NbElements(&uart->RxFIFO) == nbBefore)
+      PE_DEBUGHALT();
+  }
+
+  return LoopbackFIFO_Peek(&uart->RxFIFO, nbBytes);
+}
+
+void UART_InConsume(TUART * const uart, const uint16_t nbBytes)
+{
+  LoopbackFIFO_Consume(&uart->RxFIFO, nbBytes);
+}
+
+uint16_t UART_InNbBytes(TUART * const uart)
+{
+  return LoopbackFIFO_NbElements(&uart->RxFIFO);
+}
+
+uint8_t * UART_OutReserve(TUART * const uart, const TUARTTxClass txClass, const uint32_t timeout)
+{
+  return FIFO_SlotReserve(&uart->TxFIFOs[txClass], timeout);
+}
+
+void UART_OutCommit(TUART * const uart, const TUARTTxClass txClass, uint8_t * const dataPtr, const uint8_t nbBytes)
+{
+  TSlotFIFO * const txFIFO = &uart->TxFIFOs[txClass];
+  uint8_t slotNbBytes;
+  uint8_t i;
+
+  FIFO_SlotCommit(txFIFO, dataPtr, nbBytes);
+
+  // Move the message across the line at once, as the transmit DMA channel does
+  const uint8_t * const slotPtr = FIFO_SlotGetAll(txFIFO, &slotNbBytes);
+  uint8_t line[FIFO_SLOT_SIZE];
+
+  if (!slotPtr)
+    PE_DEBUGHALT();
+
+  for (i = 0; i < slotNbBytes; i++)
+  {
+    line[i] = slotPtr[i];
+
+    // Flip a random non-empty set of bits
+    if (NextRandom(&uart->Random) < uart->ErrorThreshold)
+    {
+      uint8_t flips;
+
+      do
+        flips = (uint8_t) NextRandom(&uart->Random);
+      while (flips == 0);
+
+      line[i] ^= flips;
+      uart->NbCorrupted++;
+      uart->Statistics.NbNoiseErrors++;
+    }
+  }
+
+  const uint32_t isrCycles = LOOPBACK_ISR_CYCLES + LOOPBACK_ISR_CYCLES_PER_BYTE * slotNbBytes;
+
+  uart->Statistics.NbTxBytes += slotNbBytes;
+  uart->Statistics.NbRxBytes += slotNbBytes;
+  uart->Statistics.NbInterrupts++;
+  uart->Statistics.TotalISRCycles += isrCycles;
+  if (isrCycles < uart->Statistics.MinISRCycles)
+    uart->Statistics.MinISRCycles = isrCycles;
+  if (isrCycles > uart->Statistics.MaxISRCycles)
+    uart->Statistics.MaxISRCycles = isrCycles;
+
+  FIFO_SlotRelease(txFIFO);
+
+  // The receiver must keep up, as nothing on the host reads the receive FIFO in the background
+  if (!LoopbackFIFO_TryPutN(&uart->RxFIFO, line, slotNbBytes))
+    PE_DEBUGHALT();
+}
+
+void UART_GetStatistics(TUART * const uart, TUARTStatistics * const statisticsPtr)
+{
+  *statisticsPtr = uart->Statistics;
+
+  if (statisticsPtr->NbInterrupts == 0)
+    statisticsPtr->MinISRCycles = 0;
+}
+
+void UART_SetReceiveThreshold(TUART * const uart, const uint16_t nbBytes)
+{
+  LoopbackFIFO_SetWakeThreshold(&uart->RxFIFO, nbBytes);
+}
@@ -0,0 +1,54 @@
+/*! @file
+ *
+ *  @brief A UART for the host that receives everything it transmits, for running the packet module on Linux.
+ *
+ *  This implements the parts of UART.h the packet module uses. Each committed transmit slot goes straight
+ *  into the receive FIFO, with its bytes corrupted at random at a chosen rate, so a packet that is put can be got back.
+ *  UART_GetStatistics counts the corrupted bytes as noise errors, and each message moved as one interrupt.
+ *
+ *  @author Group 13, Jacob Dunk (11654718) & Brenton Smith (11380654)
+ *  @date 2016-11-14
+ */
+
+#ifndef LOOPBACKUART_H
+#define LOOPBACKUART_H
+
+#include "types.h"
+#include "UART.h"
+
+/*! @brief Called when a receiver needs more bytes than have been transmitted, to transmit some more.
+ *
+ *  @param context The context given to Loopback_SetRefill.
+ */
+typedef void (*TLoopbackRefill)(void* const context);
+
+/*! @brief Sets what is called to transmit more, as a receiver on the host cannot block waiting for another thread.
+ *
+ *  @param uart The UART instance.
+ *  @param refill The function to call, NULL to halt when a receiver runs out of bytes.
+ *  @param context Passed to refill.
+ */
+void Loopback_SetRefill(TUART* const uart, const TLoopbackRefill refill, void* const context);
+
+/*! @brief Sets how often transmitted bytes are corrupted on their way to the receiver.
+ *
+ *  @param uart The UART instance.
+ *  @param byteErrorRate The probability each byte has one or more of its bits flipped, from 0 to 1.
+ *  @param seed The seed of the random corruption, so a run can be repeated.
+ */
+void Loopback_SetErrorRate(TUART* const uart, const double byteErrorRate, const uint32_t seed);
+
+/*! @brief Gets the number of bytes that have been corrupted.
+ *
+ *  @param uart The UART instance.
+ *  @return uint32_t - The number of bytes corrupted since UART_Init.
+ */
+uint32_t Loopback_NbCorrupted(TUART* const uart);
+
+/*! @brief Discards everything received, e.g. between benchmark runs.
+ *
+ *  @param uart The UART instance.
+ */
+void Loopback_Clear(TUART* const uart);
+
+#endif
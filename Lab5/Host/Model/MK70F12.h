@@ -0,0 +1,50 @@
+/*! @file
+ *
+ *  @brief Host register model of the K70 peripherals UART2 uses, for testing UART.c on Linux.
+ *
+ *  This includes the real MK70F12.h, then moves the base pointers of those peripherals onto ordinary variables.
+ *  A test plays the part of the hardware by reading what the driver writes to them, and writing back status.
+ *  As the driver writes addresses into 32-bit DMA registers, the test must be linked -no-pie,
+ *  so the variables it hands to the DMA channel have addresses that fit.
+ *
+ *  @author Group 13, Jacob Dunk (11654718) & Brenton Smith (11380654)
+ *  @date 2016-11-14
+ */
+
+#ifndef MODEL_MK70F12_H
+#define MODEL_MK70F12_H
+
+#include "../../Static_Code/IO_Map/MK70F12.h"
+
+// The modelled peripherals, defined by the test
+extern volatile struct UART_MemMap Model_UART2;
+extern volatile struct DMA_MemMap Model_DMA;
+extern volatile struct DMAMUX_MemMap Model_DMAMUX0;
+extern volatile struct SIM_MemMap Model_SIM;
+extern volatile struct PORT_MemMap Model_PORTE;
+extern volatile struct GPIO_MemMap Model_PTE;
+extern volatile struct NVIC_MemMap Model_NVIC;
+extern volatile struct DWT_MemMap Model_DWT;
+extern volatile struct CoreDebug_MemMap Model_CoreDebug;
+
+#undef UART2_BASE_PTR
+#undef DMA_BASE_PTR
+#undef DMAMUX0_BASE_PTR
+#undef SIM_BASE_PTR
+#undef PORTE_BASE_PTR
+#undef PTE_BASE_PTR
+#undef NVIC_BASE_PTR
+#undef DWT_BASE_PTR
+#undef CoreDebug_BASE_PTR
+
+#define UART2_BASE_PTR (&Model_UART2)
+#define DMA_BASE_PTR (&Model_DMA)
+#define DMAMUX0_BASE_PTR (&Model_DMAMUX0)
+#define SIM_BASE_PTR (&Model_SIM)
+#define PORTE_BASE_PTR (&Model_PORTE)
+#define PTE_BASE_PTR (&Model_PTE)
+#define NVIC_BASE_PTR (&Model_NVIC)
+#define DWT_BASE_PTR (&Model_DWT)
+#define CoreDebug_BASE_PTR (&Model_CoreDebug)
+
+#endif
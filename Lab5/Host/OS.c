@@ -0,0 +1,130 @@
+/*! @file
+ *
+ *  @brief Host stand-in for the RTOS, for building the Sources on Linux.
+ *
+ *  This contains counting semaphores on pthreads, a millisecond tick and the critical section of Stubs/PE_Types.h.
+ *
+ *  @author Group 13, Jacob Dunk (11654718) & Brenton Smith (11380654)
+ *  @date 2016-11-14
+ */
+
+#define _GNU_SOURCE
+
+#include "OS.h"
+#include "PE_Types.h"
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+struct ecb
+{
+  pthread_mutex_t Mutex;  /*!< Guards Count */
+  pthread_cond_t Signal;  /*!< Broadcast when Count is incremented */
+  uint32_t Count;         /*!< The semaphore count */
+};
+
+// The critical section, which a thread may enter again while it holds it
+static pthread_mutex_t CriticalMutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+void Host_EnterCritical(void)
+{
+  (void) pthread_mutex_lock(&CriticalMutex);
+}
+
+void Host_ExitCritical(void)
+{
+  (void) pthread_mutex_unlock(&CriticalMutex);
+}
+
+void OS_ISREnter(void)
+{
+}
+
+void OS_ISRExit(void)
+{
+}
+
+OS_ECB* OS_SemaphoreCreate(const uint32_t value)
+{
+  OS_ECB * const semaphore = malloc(sizeof(OS_ECB));
+  pthread_condattr_t attributes;
+
+  if (!semaphore)
+    return NULL;
+
+  // Time out against the monotonic clock, like the OS ticks
+  (void) pthread_condattr_init(&attributes);
+  (void) pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+  (void) pthread_mutex_init(&semaphore->Mutex, NULL);
+  (void) pthread_cond_init(&semaphore->Signal, &attributes);
+  (void) pthread_condattr_destroy(&attributes);
+  semaphore->Count = value;
+  return semaphore;
+}
+
+OS_ERROR OS_SemaphoreSignal(OS_ECB* const pEvent)
+{
+  OS_ERROR error = OS_NO_ERROR;
+
+  (void) pthread_mutex_lock(&pEvent->Mutex);
+
+  if (pEvent->Count == UINT32_MAX)
+    error = OS_SEMAPHORE_OVERFLOW;
+  else
+    pEvent->Count++;
+
+  (void) pthread_cond_signal(&pEvent->Signal);
+  (void) pthread_mutex_unlock(&pEvent->Mutex);
+  return error;
+}
+
+OS_ERROR OS_SemaphoreWait(OS_ECB* const pEvent, const uint32_t timeout)
+{
+  struct timespec deadline;
+  OS_ERROR error = OS_NO_ERROR;
+
+  // A tick is a millisecond
+  (void) clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += timeout / 1000;
+  deadline.tv_nsec += (long)(timeout % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L)
+  {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+
+  (void) pthread_mutex_lock(&pEvent->Mutex);
+
+  while (pEvent->Count == 0 && error == OS_NO_ERROR)
+  {
+    if (timeout == 0)
+      (void) pthread_cond_wait(&pEvent->Signal, &pEvent->Mutex);
+    else if (pthread_cond_timedwait(&pEvent->Signal, &pEvent->Mutex, &deadline) == ETIMEDOUT)
+      error = OS_TIMEOUT;
+  }
+
+  // A signal that raced the time out still counts
+  if (pEvent->Count > 0)
+  {
+    pEvent->Count--;
+    error = OS_NO_ERROR;
+  }
+
+  (void) pthread_mutex_unlock(&pEvent->Mutex);
+  return error;
+}
+
+void OS_TimeDelay(const uint32_t ticks)
+{
+  const struct timespec delay = { (time_t)(ticks / 1000), (long)(ticks % 1000) * 1000000L };
+
+  (void) nanosleep(&delay, NULL);
+}
+
+uint32_t OS_TimeGet(void)
+{
+  struct timespec now;
+
+  (void) clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)((uint64_t) now.tv_sec * 1000 + (uint64_t) now.tv_nsec / 1000000);
+}
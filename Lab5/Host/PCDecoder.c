@@ -0,0 +1,199 @@
+/*! @file
+ *
+ *  @brief A reference decoder of what the Tower sends, as the PC end of the Tower protocol.
+ *
+ *  This contains the framing and checking of the received bytes, and the decoding of the messages.
+ *
+ *  @author Group 13, Jacob Dunk (11654718) & Brenton Smith (11380654)
+ *  @date 2016-11-14
+ */
+
+#include "PCDecoder.h"
+#include "CRC.h"
+#include "COBS.h"
+#include <string.h>
+
+// The size of a message on a raw link that cannot be valid, whatever follows
+#define PCDECODER_INVALID_SIZE UINT16_MAX
+
+/*! @brief Checks the check bytes of a message.
+ *
+ *  @param message The message, followed by its check bytes.
+ *  @param nbBytes The number of bytes before the check bytes.
+ *  @return bool - TRUE if the check bytes match.
+ */
+static bool IsCheckValid(const uint8_t message[], const uint16_t nbBytes)
+{
+#ifdef PACKET_CRC
+  uint16union_t crc;
+  crc.l = CRC_Calculate16(message, nbBytes);
+
+  return message[nbBytes] == crc.s.Lo && message[nbBytes + 1] == crc.s.Hi;
+#else
+  uint8_t checksum = 0;
+  uint16_t i;
+
+  // The checksum is the XOR of the bytes before it, so XORing it in too gives 0
+  for (i = 0; i <= nbBytes; i++)
+    checksum ^= message[i];
+
+  return checksum == 0;
+#endif
+}
+
+/*! @brief Finds the size of the message starting at the first byte received on a raw link.
+ *
+ *  @param bytes The bytes received, from the first byte of the message.
+ *  @param nbBytes The number of bytes received, at least 1.
+ *  @return uint16_t - The size of the message including its check bytes, 0 if more bytes are needed to tell,
+ *                     or PCDECODER_INVALID_SIZE if the header gives a frame larger than the Tower can send.
+ */
+static uint16_t MessageSize(const uint8_t bytes[], const uint16_t nbBytes)
+{
+  if (bytes[0] != ANALOG_COMMAND_FRAME)
+    return PACKET_SIZE;
+
+  // The frame header gives the number of channels and samples
+  if (nbBytes < 3)
+    return 0;
+
+  const uint32_t nbPayload = ANALOG_FRAME_HEADER_SIZE + 2 * (uint32_t) bytes[1] * bytes[2];
+
+  if (nbPayload > PACKET_FRAME_MAX_PAYLOAD)
+    return PCDECODER_INVALID_SIZE;
+
+  return (uint16_t)(1 + nbPayload + PACKET_CHECK_NB_BYTES);
+}
+
+void PCDecoder_Init(TPCDecoder* const decoder, const TPacketTransport transport)
+{
+  decoder->Transport = transport;
+  decoder->NbBytes = 0;
+  decoder->NbReturned = 0;
+  decoder->NbDiscarded = 0;
+  COBS_DecoderInit(&decoder->COBSDecoder, decoder->Bytes, sizeof(decoder->Bytes));
+}
+
+/*! @brief Decodes the next byte received on a COBS link.
+ *
+ *  @param decoder The decoder.
+ *  @param data The received byte.
+ *  @param messagePtr A pointer to store the address of the message once data completes a valid one.
+ *  @return uint16_t - The number of bytes in the message before its check bytes, otherwise 0.
+ */
+static uint16_t PutCOBS(TPCDecoder* const decoder, const uint8_t data, const uint8_t** const messagePtr)
+{
+  const uint16_t nbBytes = COBS_Decode(&decoder->COBSDecoder, data);
+
+  if (nbBytes == 0)
+    return 0;
+
+  // The delimiter gives the length, so a message only needs its check bytes to match
+  if (nbBytes <= PACKET_CHECK_NB_BYTES || !IsCheckValid(decoder->Bytes, nbBytes - PACKET_CHECK_NB_BYTES))
+  {
+    decoder->NbDiscarded++;
+    return 0;
+  }
+
+  *messagePtr = decoder->Bytes;
+  return nbBytes - PACKET_CHECK_NB_BYTES;
+}
+
+uint16_t PCDecoder_Put(TPCDecoder* const decoder, const uint8_t data, const uint8_t** const messagePtr)
+{
+  if (decoder->Transport == PACKET_TRANSPORT_COBS)
+    return PutCOBS(decoder, data, messagePtr);
+
+  // Remove the message returned last time, keeping any bytes received after it
+  if (decoder->NbReturned != 0)
+  {
+    decoder->NbBytes -= decoder->NbReturned;
+    memmove(decoder->Bytes, &decoder->Bytes[decoder->NbReturned], decoder->NbBytes);
+    decoder->NbReturned = 0;
+  }
+
+  decoder->Bytes[decoder->NbBytes++] = data;
+
+  while (decoder->NbBytes != 0)
+  {
+    const uint16_t size = MessageSize(decoder->Bytes, decoder->NbBytes);
+
+    // Wait for the rest of the message
+    if (size == 0 || (size != PCDECODER_INVALID_SIZE && decoder->NbBytes < size))
+      return 0;
+
+    if (size != PCDECODER_INVALID_SIZE && IsCheckValid(decoder->Bytes, size - PACKET_CHECK_NB_BYTES))
+    {
+      decoder->NbReturned = size;
+      *messagePtr = decoder->Bytes;
+      return size - PACKET_CHECK_NB_BYTES;
+    }
+
+    // Not a message, so try again from the next byte
+    decoder->NbBytes--;
+    memmove(decoder->Bytes, &decoder->Bytes[1], decoder->NbBytes);
+    decoder->NbDiscarded++;
+  }
+
+  return 0;
+}
+
+bool PCDecoder_AnalogFrame(const uint8_t message[], const uint16_t nbBytes, TPCAnalogFrame* const frame)
+{
+  uint16_t i;
+
+  if (nbBytes < 1 + ANALOG_FRAME_HEADER_SIZE || message[0] != ANALOG_COMMAND_FRAME)
+    return false;
+
+  frame->NbChannels = message[1];
+  frame->NbSamples = message[2];
+  frame->SequenceNb = message[3];
+
+  const uint32_t nbValues = (uint32_t) frame->NbChannels * frame->NbSamples;
+
+  if (nbValues > PCDECODER_MAX_FRAME_VALUES || nbBytes != 1 + ANALOG_FRAME_HEADER_SIZE + 2 * nbValues)
+    return false;
+
+  // Each value is sent LSB first
+  for (i = 0; i < nbValues; i++)
+  {
+    const uint8_t * const valueBytes = &message[1 + ANALOG_FRAME_HEADER_SIZE + 2 * i];
+
+    frame->Values[i] = (int16_t)(valueBytes[0] | (valueBytes[1] << 8));
+  }
+
+  return true;
+}
+
+void PCDecoder_UARTStatisticsInit(TPCUARTStatistics* const statistics)
+{
+  memset(statistics->Halves, 0, sizeof(statistics->Halves));
+  statistics->Received = 0;
+}
+
+bool PCDecoder_UARTStatistic(TPCUARTStatistics* const statistics, const uint8_t message[], const uint16_t nbBytes)
+{
+  if (nbBytes != PACKET_NB_DATA_BYTES || message[0] != PACKET_COMMAND_UART_STATISTICS
+      || message[1] >= UART_STATISTIC_NB_PACKETS)
+    return false;
+
+  // Parameter 2 is the LSB, parameter 3 the MSB
+  statistics->Halves[message[1]] = (uint16_t)(message[2] | (message[3] << 8));
+  statistics->Received |= (uint32_t) 1 << message[1];
+  return true;
+}
+
+bool PCDecoder_UARTStatisticsComplete(const TPCUARTStatistics* const statistics)
+{
+  return statistics->Received == ((uint32_t) 1 << UART_STATISTIC_NB_PACKETS) - 1;
+}
+
+uint32_t PCDecoder_UARTStatisticValue(const TPCUARTStatistics* const statistics, const TPacketUARTStatistic statisticNb)
+{
+  return ((uint32_t) statistics->Halves[statisticNb + 1] << 16) | statistics->Halves[statisticNb];
+}
+
+double PCDecoder_AvgISRMicroseconds(const TPCUARTStatistics* const statistics, const uint32_t coreClkHz)
+{
+  return PCDecoder_UARTStatisticValue(statistics, UART_STATISTIC_AVG_ISR_CYCLES) * 1e6 / coreClkHz;
+}
@@ -0,0 +1,134 @@
+/*! @file
+ *
+ *  @brief A reference decoder of what the Tower sends, as the PC end of the Tower protocol.
+ *
+ *  This finds the packets and frames in the bytes received from the Tower on either transport, checking them
+ *  the same way as packet.c: a CRC-16 if PACKET_CRC is defined, otherwise an XOR checksum.
+ *  It then decodes the "Analog Input - Frame" frames, and rebuilds the "UART - Statistics" from their two halves.
+ *  A PC application can build it unchanged, along with COBS.c and CRC.c.
+ *
+ *  @author Group 13, Jacob Dunk (11654718) & Brenton Smith (11380654)
+ *  @date 2016-11-14
+ */
+
+#ifndef PCDECODER_H
+#define PCDECODER_H
+
+#include "types.h"
+#include "packet.h"
+#include "analog.h"
+
+// Largest message the Tower sends, a frame that fills a transmit slot, before any COBS encoding
+#define PCDECODER_MAX_MESSAGE_SIZE (1 + PACKET_FRAME_MAX_PAYLOAD + PACKET_CHECK_NB_BYTES)
+
+// Largest number of values in an "Analog Input - Frame", of all its channels together
+#define PCDECODER_MAX_FRAME_VALUES ((PACKET_FRAME_MAX_PAYLOAD - ANALOG_FRAME_HEADER_SIZE) / 2)
+
+/*!
+ * @struct TPCDecoder
+ *
+ * The state of the messages being received from the Tower, owned by the caller.
+ */
+typedef struct
+{
+  TPacketTransport Transport;                   /*!< How the Tower delimits its packets and frames */
+  uint8_t Bytes[PCDECODER_MAX_MESSAGE_SIZE];    /*!< The message being received on a raw link, or decoded on a COBS link */
+  uint16_t NbBytes;                             /*!< The number of bytes received into Bytes on a raw link */
+  uint16_t NbReturned;                          /*!< The size of the message last returned on a raw link, removed by the next byte */
+  TCOBSDecoder COBSDecoder;                     /*!< Decodes the received bytes on a COBS link */
+  uint32_t NbDiscarded;                         /*!< Bytes skipped on a raw link, or frames discarded on a COBS link, as their check failed */
+} TPCDecoder;
+
+/*!
+ * @struct TPCAnalogFrame
+ *
+ * A decoded "Analog Input - Frame".
+ */
+typedef struct
+{
+  uint8_t NbChannels;                           /*!< The number of channels, M */
+  uint8_t NbSamples;                            /*!< The number of samples of each channel, N */
+  uint8_t SequenceNb;                           /*!< The sequence number, a gap in which means frames were dropped */
+  int16_t Values[PCDECODER_MAX_FRAME_VALUES];   /*!< The M * N values, oldest sample first, each sample holding every channel in order */
+} TPCAnalogFrame;
+
+/*!
+ * @struct TPCUARTStatistics
+ *
+ * The link statistics of the Tower's UART, rebuilt from the packets of a "UART - Statistics" reply.
+ */
+typedef struct
+{
+  uint16_t Halves[UART_STATISTIC_NB_PACKETS];   /*!< The value of each packet, indexed by its parameter 1 */
+  uint32_t Received;                            /*!< Bit n is set once the packet with parameter 1 = n has been received */
+} TPCUARTStatistics;
+
+/*! @brief Prepares a decoder for the bytes from the Tower.
+ *
+ *  @param decoder The decoder.
+ *  @param transport How the Tower delimits its packets and frames, as set by "Protocol - Mode".
+ */
+void PCDecoder_Init(TPCDecoder* const decoder, const TPacketTransport transport);
+
+/*! @brief Decodes the next byte received from the Tower.
+ *
+ *  On a raw link the length of a message is found from its command, so a frame is told apart from a packet by
+ *  its command and header. After a message fails its check, the decoder slides along one byte at a time
+ *  until a valid one is found, as packet.c does.
+ *
+ *  @param decoder The decoder.
+ *  @param data The received byte.
+ *  @param messagePtr A pointer to store the address of the message once data completes a valid one.
+ *  @return uint16_t - The number of bytes in the message, from its command to before its check bytes, once data
+ *                     completes a valid one, otherwise 0. The message remains valid until the next call.
+ */
+uint16_t PCDecoder_Put(TPCDecoder* const decoder, const uint8_t data, const uint8_t** const messagePtr);
+
+/*! @brief Decodes an "Analog Input - Frame" message.
+ *
+ *  @param message The message, as returned by PCDecoder_Put.
+ *  @param nbBytes The number of bytes in the message.
+ *  @param frame A pointer to store the frame.
+ *  @return bool - TRUE if the message is an "Analog Input - Frame" of the length its header gives.
+ */
+bool PCDecoder_AnalogFrame(const uint8_t message[], const uint16_t nbBytes, TPCAnalogFrame* const frame);
+
+/*! @brief Prepares for the packets of a "UART - Statistics" reply, forgetting any received before.
+ *
+ *  @param statistics The statistics being rebuilt.
+ */
+void PCDecoder_UARTStatisticsInit(TPCUARTStatistics* const statistics);
+
+/*! @brief Adds a "UART - Statistics" packet to the statistics being rebuilt.
+ *
+ *  @param statistics The statistics being rebuilt.
+ *  @param message The message, as returned by PCDecoder_Put.
+ *  @param nbBytes The number of bytes in the message.
+ *  @return bool - TRUE if the message is a "UART - Statistics" packet.
+ */
+bool PCDecoder_UARTStatistic(TPCUARTStatistics* const statistics, const uint8_t message[], const uint16_t nbBytes);
+
+/*! @brief Checks whether both halves of every statistic have been received.
+ *
+ *  @param statistics The statistics being rebuilt.
+ *  @return bool - TRUE if the reply is complete.
+ */
+bool PCDecoder_UARTStatisticsComplete(const TPCUARTStatistics* const statistics);
+
+/*! @brief Gets a statistic, joining its low and high halves.
+ *
+ *  @param statistics The statistics being rebuilt.
+ *  @param statisticNb The statistic, its low half's number.
+ *  @return uint32_t - The value of the statistic, with 0 for any half not yet received.
+ */
+uint32_t PCDecoder_UARTStatisticValue(const TPCUARTStatistics* const statistics, const TPacketUARTStatistic statisticNb);
+
+/*! @brief Gets the average time the Tower spent in its UART ISR.
+ *
+ *  @param statistics The statistics being rebuilt.
+ *  @param coreClkHz The Tower's core clock in Hz, which the ISR cycles are counted in (CPU_CORE_CLK_HZ).
+ *  @return double - The average time of an interrupt in microseconds, 0 if none have been timed.
+ */
+double PCDecoder_AvgISRMicroseconds(const TPCUARTStatistics* const statistics, const uint32_t coreClkHz);
+
+#endif
@@ -0,0 +1,18 @@
+/*! @file
+ *
+ *  @brief Host stand-in for the Processor Expert CPU component, for building the Sources on Linux.
+ *
+ *  @author Group 13, Jacob Dunk (11654718) & Brenton Smith (11380654)
+ *  @date 2016-11-14
+ */
+
+#ifndef __Cpu_H
+#define __Cpu_H
+
+#include "PE_Types.h"
+
+// The clock rates of the TWR-K70F120M, so the baud rate divisors come out the same as on the board
+#define CPU_BUS_CLK_HZ 25000000U
+#define CPU_CORE_CLK_HZ 50000000U
+
+#endif
@@ -0,0 +1,76 @@
+/*! @file
+ *
+ *  @brief Host stand-in for the RTOS, for building the Sources on Linux.
+ *
+ *  This has the parts of Library/OS.h the FIFO, packet and UART modules use, with the same names and error codes.
+ *  Semaphores are counting semaphores on a pthread mutex and condition variable, and a tick is a millisecond.
+ *
+ *  @author Group 13, Jacob Dunk (11654718) & Brenton Smith (11380654)
+ *  @date 2016-11-14
+ */
+
+#ifndef OS_H
+#define OS_H
+
+// Standard types
+#include <stdint.h>
+#include <stdbool.h>
+
+// OS error codes, as in Library/OS.h
+typedef enum
+{
+  OS_NO_ERROR,
+  OS_TIMEOUT,
+  OS_PRIORITY_EXISTS,
+  OS_PRIORITY_INVALID,
+  OS_NO_MORE_TCBS,
+  OS_THREAD_DELETE_ERROR,
+  OS_THREAD_DELETE_IDLE,
+  OS_THREAD_DELETE_ISR,
+  OS_SEMAPHORE_OVERFLOW
+} OS_ERROR;
+
+// Event Control Block, private to OS.c
+typedef struct ecb OS_ECB;
+
+/*! @brief Notifies the OS that an ISR is being processed. Nothing to do on the host. */
+void OS_ISREnter(void);
+
+/*! @brief Notifies the OS that an ISR has completed. Nothing to do on the host. */
+void OS_ISRExit(void);
+
+/*! @brief Creates a counting semaphore.
+ *
+ *  @param value The initial count.
+ *  @return OS_ECB* - The semaphore, NULL if out of memory.
+ */
+OS_ECB* OS_SemaphoreCreate(const uint32_t value);
+
+/*! @brief Signals a semaphore, from any thread.
+ *
+ *  @param pEvent The semaphore.
+ *  @return OS_ERROR - OS_NO_ERROR, or OS_SEMAPHORE_OVERFLOW if the count overflowed.
+ */
+OS_ERROR OS_SemaphoreSignal(OS_ECB* const pEvent);
+
+/*! @brief Waits on a semaphore.
+ *
+ *  @param pEvent The semaphore.
+ *  @param timeout The number of ticks to wait, 0 to wait forever.
+ *  @return OS_ERROR - OS_NO_ERROR if the semaphore was available, OS_TIMEOUT if it was not signalled in time.
+ */
+OS_ERROR OS_SemaphoreWait(OS_ECB* const pEvent, const uint32_t timeout);
+
+/*! @brief Delays the calling thread.
+ *
+ *  @param ticks The number of ticks to delay.
+ */
+void OS_TimeDelay(const uint32_t ticks);
+
+/*! @brief Gets the number of ticks since the program started.
+ *
+ *  @return uint32_t - The time in ticks.
+ */
+uint32_t OS_TimeGet(void);
+
+#endif
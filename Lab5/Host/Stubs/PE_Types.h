@@ -0,0 +1,39 @@
+/*! @file
+ *
+ *  @brief Host stand-in for the Processor Expert types, for building the Sources on Linux.
+ *
+ *  Critical sections lock one recursive mutex shared by every thread, as the host has no interrupts to mask.
+ *  A debug halt aborts, so a failed check stops a test rather than being stepped over.
+ *
+ *  @author Group 13, Jacob Dunk (11654718) & Brenton Smith (11380654)
+ *  @date 2016-11-14
+ */
+
+#ifndef __PE_Types_H
+#define __PE_Types_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#ifndef FALSE
+  #define FALSE 0x00u
+#endif
+#ifndef TRUE
+  #define TRUE 0x01u
+#endif
+
+/*! @brief Enter the critical section shared by every thread, which may be nested. Implemented in OS.c */
+void Host_EnterCritical(void);
+
+/*! @brief Leave the critical section entered by Host_EnterCritical. Implemented in OS.c */
+void Host_ExitCritical(void);
+
+#define EnterCritical() Host_EnterCritical()
+#define ExitCritical() Host_ExitCritical()
+
+#define PE_DEBUGHALT() abort()
+#define PE_NOP()
+#define PE_WFI()
+
+#endif
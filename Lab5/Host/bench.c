@@ -0,0 +1,568 @@
+/*! @file
+ *
+ *  @brief Micro-benchmarks of the FIFO, packet and median filter modules, run on the host.
+ *
+ *  Each result is printed on its own line as a JSON object, so runs can be collected and compared
+ *  to track regressions. Every object has "bench", the parameter it was run with, "ops",
+ *  "ns_per_op" and "ops_per_s", plus "bytes_per_s" where the operation moves bytes.
+ *  The packet_resync results also count the packets corrupted on the line, the false accepts, and the intact packets
+ *  lost while the receiver found the packet boundaries again.
+ *
+ *  Usage: bench [milliseconds per measurement, default 200]
+ *
+ *  @author Group 13, Jacob Dunk (11654718) & Brenton Smith (11380654)
+ *  @date 2016-11-14
+ */
+
+#define _GNU_SOURCE
+
+#include "types.h"
+#include "FIFO.h"
+#include "packet.h"
+#include "median.h"
+#include "LoopbackUART.h"
+#include "Cpu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Command ID has bit 7 (MSB) reserved for packet acknowledgement, as in main.c
+const uint8_t PACKET_ACK_MASK = 1 << 7;
+
+// Operations between checks of the clock, so reading it does not show in the results
+#define BENCH_BATCH 1024
+
+// Packets transmitted each time the receiver runs out
+#define BENCH_REFILL_NB_PACKETS 16
+
+// The command the benchmark packets are sent with, an unused one
+#define BENCH_COMMAND 0x7E
+
+// Nanoseconds each measurement runs for
+static uint64_t MeasureNs = 200000000;
+
+// Defeats the optimiser, so benchmarked results are always used
+static volatile uint32_t Sink;
+
+/*! @brief Gets the time from a monotonic clock.
+ *
+ *  @return uint64_t - The time in nanoseconds.
+ */
+static uint64_t NowNs(void)
+{
+  struct timespec now;
+
+  (void) clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+/*! @brief Prints a result as one line of JSON.
+ *
+ *  @param bench The name of the benchmark.
+ *  @param parameter The extra fields that describe the run, e.g. "\"size\":5".
+ *  @param nbOps The number of operations timed.
+ *  @param ns The time they took in nanoseconds.
+ *  @param bytesPerOp The bytes each operation moves, 0 if it does not move bytes.
+ */
+static void Report(const char * const bench, const char * const parameter, const uint64_t nbOps, const uint64_t ns,
+    const uint32_t bytesPerOp)
+{
+  const double seconds = (double) ns / 1e9;
+
+  printf("{\"bench\":\"%s\",%s,\"ops\":%llu,\"ns_per_op\":%.2f,\"ops_per_s\":%.0f", bench, parameter,
+      (unsigned long long) nbOps, (double) ns / (double) nbOps, (double) nbOps / seconds);
+  if (bytesPerOp != 0)
+    printf(",\"bytes_per_s\":%.0f", (double) nbOps * bytesPerOp / seconds);
+  printf("}\n");
+  fflush(stdout);
+}
+
+/*! @brief Puts then gets nbBytes at a time through the default byte FIFO.
+ *
+ *  @param nbBytes The number of bytes moved by each PutN and GetN.
+ */
+static void BenchFIFOPutGet(const uint16_t nbBytes)
+{
+  static TFIFO fifo;
+  uint8_t data[FIFO_SIZE];
+  uint64_t nbOps = 0;
+  uint16_t i;
+  char parameter[32];
+
+  FIFO_Init(&fifo);
+  for (i = 0; i < nbBytes; i++)
+    data[i] = (uint8_t) i;
+
+  const uint64_t start = NowNs();
+  uint64_t elapsed;
+
+  do
+  {
+    for (i = 0; i < BENCH_BATCH; i++)
+    {
+      (void) FIFO_PutN(&fifo, data, nbBytes);
+      (void) FIFO_GetN(&fifo, data, nbBytes);
+    }
+    nbOps += BENCH_BATCH;
+    elapsed = NowNs() - start;
+  } while (elapsed < MeasureNs);
+
+  Sink = data[0];
+  snprintf(parameter, sizeof(parameter), "\"nb_bytes\":%u", nbBytes);
+  Report("fifo_put_get", parameter, nbOps, elapsed, nbBytes);
+}
+
+/*! @brief Puts a byte at a time and examines them in place, as the packet receiver does.
+ *
+ *  @param nbBytes The number of bytes peeked at and consumed at once.
+ */
+static void BenchFIFOPeekConsume(const uint16_t nbBytes)
+{
+  static TFIFO fifo;
+  uint64_t nbOps = 0;
+  uint16_t i, j;
+  char parameter[32];
+
+  FIFO_Init(&fifo);
+
+  const uint64_t start = NowNs();
+  uint64_t elapsed;
+
+  do
+  {
+    for (i = 0; i < BENCH_BATCH; i++)
+    {
+      for (j = 0; j < nbBytes; j++)
+        (void) FIFO_Put(&fifo, (uint8_t) j);
+      Sink = FIFO_Peek(&fifo, nbBytes)[nbBytes - 1];
+      FIFO_Consume(&fifo, nbBytes);
+    }
+    nbOps += BENCH_BATCH;
+    elapsed = NowNs() - start;
+  } while (elapsed < MeasureNs);
+
+  snprintf(parameter, sizeof(parameter), "\"nb_bytes\":%u", nbBytes);
+  Report("fifo_put_peek_consume", parameter, nbOps, elapsed, nbBytes);
+}
+
+/*! @brief Builds messages in place in a slot FIFO and gets them whole, as packets are transmitted.
+ *
+ *  @param nbBytes The number of bytes in each message.
+ */
+static void BenchSlotFIFO(const uint8_t nbBytes)
+{
+  static TSlotFIFO fifo;
+  static TFIFOSlot slots[8];
+  uint64_t nbOps = 0;
+  uint16_t i;
+  uint8_t slotNbBytes;
+  char parameter[32];
+
+  FIFO_SlotInit(&fifo, slots, 8);
+
+  const uint64_t start = NowNs();
+  uint64_t elapsed;
+
+  do
+  {
+    for (i = 0; i < BENCH_BATCH; i++)
+    {
+      uint8_t * const slotPtr = FIFO_SlotReserve(&fifo, 0);
+
+      memset(slotPtr, (uint8_t) i, nbBytes);
+      FIFO_SlotCommit(&fifo, slotPtr, nbBytes);
+      Sink = FIFO_SlotGetAll(&fifo, &slotNbBytes)[0];
+      FIFO_SlotRelease(&fifo);
+    }
+    nbOps += BENCH_BATCH;
+    elapsed = NowNs() - start;
+  } while (elapsed < MeasureNs);
+
+  snprintf(parameter, sizeof(parameter), "\"nb_bytes\":%u", nbBytes);
+  Report("slot_fifo_reserve_get", parameter, nbOps, elapsed, nbBytes);
+}
+
+/*! @brief Gets the name of a transport for the results.
+ *
+ *  @param transport The transport.
+ *  @return const char* - Its name.
+ */
+static const char * TransportName(const TPacketTransport transport)
+{
+  return (transport == PACKET_TRANSPORT_COBS) ? "cobs" : "raw";
+}
+
+/*! @brief Builds packets and sends them across the loopback line, discarding them on the other side.
+ *
+ *  @param transport How the packets are delimited.
+ */
+static void BenchPacketPut(const TPacketTransport transport)
+{
+  static TPacketLink link;
+  uint64_t nbOps = 0;
+  uint16_t i;
+  char parameter[48];
+
+  (void) Packet_Init(&link, &UART_Port2, 115200, CPU_BUS_CLK_HZ);
+  Packet_SetTransport(&link, transport);
+
+  const uint64_t start = NowNs();
+  uint64_t elapsed;
+
+  do
+  {
+    for (i = 0; i < BENCH_BATCH; i++)
+    {
+      (void) Packet_Put(&link, BENCH_COMMAND, (uint8_t) i, (uint8_t)(i >> 8), 0);
+
+      // Keep the receive FIFO from filling
+      if ((i & 15) == 15)
+        Loopback_Clear(&UART_Port2);
+    }
+    nbOps += BENCH_BATCH;
+    elapsed = NowNs() - start;
+  } while (elapsed < MeasureNs);
+
+  snprintf(parameter, sizeof(parameter), "\"transport\":\"%s\"", TransportName(transport));
+  Report("packet_put", parameter, nbOps, elapsed, PACKET_SIZE);
+}
+
+/*!
+ * @struct TPacketSource
+ *
+ * Transmits packets to a link's receiver whenever it runs out, timing itself so it can be left out of the results.
+ */
+typedef struct
+{
+  TPacketLink * Link;   /*!< The link the packets are sent on */
+  uint32_t NbSent;      /*!< Packets sent so far, which numbers the next one */
+  uint64_t Ns;          /*!< Nanoseconds spent sending */
+} TPacketSource;
+
+/*! @brief Sends the next BENCH_REFILL_NB_PACKETS packets, numbered in their parameters.
+ *
+ *  @param context The TPacketSource.
+ */
+static void RefillPackets(void * const context)
+{
+  TPacketSource * const source = context;
+  const uint64_t start = NowNs();
+  uint8_t i;
+
+  for (i = 0; i < BENCH_REFILL_NB_PACKETS; i++, source->NbSent++)
+    (void) Packet_Put(source->Link, BENCH_COMMAND, (uint8_t) source->NbSent, (uint8_t)(source->NbSent >> 8),
+        (uint8_t)(source->NbSent >> 16));
+
+  source->Ns += NowNs() - start;
+}
+
+/*! @brief Receives packets from a line that corrupts bytes at random, timing only the receiver.
+ *
+ *  @param transport How the packets are delimited.
+ *  @param byteErrorRate The probability that each byte is corrupted.
+ */
+static void BenchPacketGet(const TPacketTransport transport, const double byteErrorRate)
+{
+  static TPacketLink link;
+  TPacketSource source = { &link, 0, 0 };
+  TPacket packet;
+  uint64_t nbOps = 0;
+  uint16_t i;
+  char parameter[64];
+
+  (void) Packet_Init(&link, &UART_Port2, 115200, CPU_BUS_CLK_HZ);
+  Packet_SetTransport(&link, transport);
+  Loopback_SetErrorRate(&UART_Port2, byteErrorRate, 12345);
+  Loopback_SetRefill(&UART_Port2, RefillPackets, &source);
+
+  const uint64_t start = NowNs();
+  uint64_t elapsed;
+
+  do
+  {
+    for (i = 0; i < BENCH_BATCH; i++)
+    {
+      Packet_Get(&link, &packet);
+      Sink = Packet_Parameter1(&packet);
+    }
+    nbOps += BENCH_BATCH;
+    elapsed = NowNs() - start;
+  } while (elapsed < MeasureNs);
+
+  snprintf(parameter, sizeof(parameter), "\"transport\":\"%s\",\"byte_error_rate\":%g", TransportName(transport),
+      byteErrorRate);
+  Report("packet_get", parameter, nbOps, elapsed - source.Ns, PACKET_SIZE);
+}
+
+// Packets the resynchronisation fuzz keeps track of, as many as their 3 parameter bytes can number
+#define BENCH_FUZZ_MAX_PACKETS (1UL << 24)
+
+/*!
+ * @struct TFuzzSource
+ *
+ * Transmits numbered packets like TPacketSource, remembering which of them the line corrupted.
+ */
+typedef struct
+{
+  TPacketSource Source;   /*!< Sends and times the packets */
+  bool MixedCommands;     /*!< TRUE to send each packet with a command picked by its number, rather than BENCH_COMMAND */
+  uint8_t * Corrupted;    /*!< A bit per packet number, set if any byte of the packet was corrupted */
+  uint32_t NbCorrupted;   /*!< Packets corrupted */
+} TFuzzSource;
+
+/*! @brief Gets the command a fuzz packet is sent with.
+ *
+ *  A stream of one command is the worst case for the raw transport, as the XOR check of two packets with the same
+ *  command byte also passes one byte out of alignment, so the receiver stays out of alignment until the next error.
+ *
+ *  @param fuzz The TFuzzSource.
+ *  @param number The packet's number.
+ *  @return uint8_t - The command, without the acknowledgement bit.
+ */
+static inline uint8_t FuzzCommand(const TFuzzSource * const fuzz, const uint32_t number)
+{
+  return fuzz->MixedCommands ? (uint8_t)((number * 2654435761u) >> 25) : BENCH_COMMAND;
+}
+
+/*! @brief Sends the next BENCH_REFILL_NB_PACKETS packets, noting which were corrupted.
+ *
+ *  @param context The TFuzzSource.
+ */
+static void RefillFuzzPackets(void * const context)
+{
+  TFuzzSource * const fuzz = context;
+  TPacketSource * const source = &fuzz->Source;
+  const uint64_t start = NowNs();
+  uint32_t nbCorrupted;
+  uint8_t i;
+
+  for (i = 0; i < BENCH_REFILL_NB_PACKETS && source->NbSent < BENCH_FUZZ_MAX_PACKETS; i++, source->NbSent++)
+  {
+    nbCorrupted = Loopback_NbCorrupted(source->Link->UART);
+    (void) Packet_Put(source->Link, FuzzCommand(fuzz, source->NbSent), (uint8_t) source->NbSent,
+        (uint8_t)(source->NbSent >> 8), (uint8_t)(source->NbSent >> 16));
+
+    if (Loopback_NbCorrupted(source->Link->UART) != nbCorrupted)
+    {
+      fuzz->Corrupted[source->NbSent / 8] |= (uint8_t)(1 << (source->NbSent % 8));
+      fuzz->NbCorrupted++;
+    }
+  }
+
+  source->Ns += NowNs() - start;
+}
+
+/*! @brief Checks whether the line corrupted a packet.
+ *
+ *  @param fuzz The TFuzzSource that sent it.
+ *  @param number The packet's number.
+ *  @return bool - TRUE if any byte of the packet was corrupted.
+ */
+static inline bool IsCorrupted(const TFuzzSource * const fuzz, const uint32_t number)
+{
+  return (fuzz->Corrupted[number / 8] >> (number % 8)) & 1;
+}
+
+/*! @brief Fuzzes the receiver with randomly corrupted packets, measuring how well it resynchronises.
+ *
+ *  A packet that is got is accepted correctly if it is one that was sent intact, later than the last one accepted.
+ *  Anything else passed its check by chance, and is a false accept. Intact packets skipped between two correct
+ *  accepts were lost while the receiver found the packet boundaries again after a corruption,
+ *  which is the resynchronisation latency, reported per corrupted packet and as the worst seen after one burst.
+ *
+ *  @param transport How the packets are delimited.
+ *  @param mixedCommands TRUE to send packets with many commands, FALSE to send them all with one.
+ *  @param byteErrorRate The probability that each byte is corrupted.
+ */
+static void BenchPacketResync(const TPacketTransport transport, const bool mixedCommands, const double byteErrorRate)
+{
+  static TPacketLink link;
+  static uint8_t corrupted[BENCH_FUZZ_MAX_PACKETS / 8];
+  TFuzzSource fuzz = { { &link, 0, 0 }, mixedCommands, corrupted, 0 };
+  TPacket packet;
+  uint32_t number, nextNumber = 0;
+  uint64_t nbGot = 0, nbFalseAccepts = 0, nbLost = 0;
+  uint32_t nbGapLost, maxGapLost = 0;
+
+  memset(corrupted, 0, sizeof(corrupted));
+  (void) Packet_Init(&link, &UART_Port2, 115200, CPU_BUS_CLK_HZ);
+  Packet_SetTransport(&link, transport);
+  Loopback_SetErrorRate(&UART_Port2, byteErrorRate, 54321);
+  Loopback_SetRefill(&UART_Port2, RefillFuzzPackets, &fuzz);
+
+  const uint64_t start = NowNs();
+  uint64_t elapsed = 0;
+
+  // Stop short of the last packets numbered, so the receiver never runs out
+  do
+  {
+    Packet_Get(&link, &packet);
+    nbGot++;
+    number = Packet_Parameter1(&packet) | (uint32_t) Packet_Parameter2(&packet) << 8
+        | (uint32_t) Packet_Parameter3(&packet) << 16;
+
+    if (number < nextNumber || number >= fuzz.Source.NbSent || Packet_Command(&packet) != FuzzCommand(&fuzz, number)
+        || IsCorrupted(&fuzz, number))
+    {
+      nbFalseAccepts++;
+      continue;
+    }
+
+    for (nbGapLost = 0; nextNumber < number; nextNumber++)
+      if (!IsCorrupted(&fuzz, nextNumber))
+        nbGapLost++;
+
+    nbLost += nbGapLost;
+    if (nbGapLost > maxGapLost)
+      maxGapLost = nbGapLost;
+    nextNumber = number + 1;
+    elapsed = NowNs() - start;
+  } while (elapsed < MeasureNs && fuzz.Source.NbSent < BENCH_FUZZ_MAX_PACKETS - 2 * BENCH_REFILL_NB_PACKETS);
+
+  elapsed -= fuzz.Source.Ns;
+  printf("{\"bench\":\"packet_resync\",\"transport\":\"%s\",\"commands\":\"%s\",\"byte_error_rate\":%g,\"ops\":%llu,\"ns_per_op\":%.2f,\"ops_per_s\":%.0f,"
+      "\"packets_sent\":%u,\"packets_corrupted\":%u,\"false_accepts\":%llu,\"false_accept_rate\":%g,"
+      "\"intact_lost\":%llu,\"intact_lost_per_corrupted\":%.3f,\"max_intact_lost\":%u}\n",
+      TransportName(transport), mixedCommands ? "mixed" : "one", byteErrorRate, (unsigned long long) nbGot,
+      (double) elapsed / (double) nbGot, (double) nbGot * 1e9 / (double) elapsed, nextNumber, fuzz.NbCorrupted,
+      (unsigned long long) nbFalseAccepts, (double) nbFalseAccepts / (double) nbGot, (unsigned long long) nbLost,
+      fuzz.NbCorrupted ? (double) nbLost / fuzz.NbCorrupted : 0.0, maxGapLost);
+  fflush(stdout);
+}
+
+/*! @brief A command handler that only uses its packet.
+ *
+ *  @param link Unused, as nothing is sent.
+ *  @param packet The packet.
+ *  @return bool - TRUE.
+ */
+static bool DispatchHandler(TPacketLink * const link, const TPacket * const packet)
+{
+  (void) link;
+  Sink += Packet_Parameter1(packet);
+  return true;
+}
+
+/*! @brief Dispatches packets through a link's table, with every even command registered.
+ *
+ *  @param name The case, for the results.
+ *  @param command The command of every packet, or PACKET_NB_COMMANDS to spread the packets over every command,
+ *                 registered or not, with and without the acknowledgement bit.
+ *  @param parameter3 The third parameter, which the registered commands require to be 0.
+ */
+static void BenchPacketDispatch(const char * const name, const uint8_t command, const uint8_t parameter3)
+{
+  static TPacketLink link;
+  static TPacket packets[BENCH_BATCH];
+  uint64_t nbOps = 0;
+  uint16_t i;
+  char parameter[48];
+
+  (void) Packet_Init(&link, &UART_Port2, 115200, CPU_BUS_CLK_HZ);
+  for (i = 0; i < PACKET_NB_COMMANDS; i += 2)
+    (void) Packet_Register(&link, (uint8_t) i, DispatchHandler, PACKET_PARAMETER3_ZERO);
+
+  for (i = 0; i < BENCH_BATCH; i++)
+  {
+    Packet_Command(&packets[i]) = (command == PACKET_NB_COMMANDS) ? (uint8_t)(i * 37) : command;
+    Packet_Parameter1(&packets[i]) = (uint8_t) i;
+    Packet_Parameter2(&packets[i]) = (uint8_t)(i >> 8);
+    Packet_Parameter3(&packets[i]) = parameter3;
+  }
+
+  const uint64_t start = NowNs();
+  uint64_t elapsed;
+
+  do
+  {
+    for (i = 0; i < BENCH_BATCH; i++)
+      (void) Packet_Dispatch(&link, &packets[i]);
+    nbOps += BENCH_BATCH;
+    elapsed = NowNs() - start;
+  } while (elapsed < MeasureNs);
+
+  snprintf(parameter, sizeof(parameter), "\"case\":\"%s\"", name);
+  Report("packet_dispatch", parameter, nbOps, elapsed, 0);
+}
+
+/*! @brief Median filters windows of random samples.
+ *
+ *  @param size The number of samples in the window.
+ */
+static void BenchMedian(const uint32_t size)
+{
+  static int16_t samples[1024 + BENCH_BATCH];
+  uint64_t nbOps = 0;
+  uint32_t i;
+  uint32_t random = 2463534242u;
+  char parameter[32];
+
+  // Each call filters a different window, as the analog threads do
+  for (i = 0; i < sizeof(samples) / sizeof(samples[0]); i++)
+  {
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    samples[i] = (int16_t) random;
+  }
+
+  const uint64_t start = NowNs();
+  uint64_t elapsed;
+
+  do
+  {
+    for (i = 0; i < BENCH_BATCH; i++)
+      Sink = (uint32_t) Median_Filter(&samples[i], size);
+    nbOps += BENCH_BATCH;
+    elapsed = NowNs() - start;
+  } while (elapsed < MeasureNs);
+
+  snprintf(parameter, sizeof(parameter), "\"size\":%u", size);
+  Report("median_filter", parameter, nbOps, elapsed, 0);
+}
+
+int main(int argc, char * argv[])
+{
+  static const uint16_t FIFONbBytes[] = { 1, 5, 8, 64 };
+  static const double ByteErrorRates[] = { 0.0, 0.001, 0.01, 0.05 };
+  static const uint32_t MedianSizes[] = { 3, 5, 8, 16, 32, 64, 256, 1024 };
+  TPacketTransport transport;
+  uint32_t i;
+
+  if (argc > 1)
+    MeasureNs = strtoull(argv[1], NULL, 10) * 1000000ULL;
+
+  for (i = 0; i < sizeof(FIFONbBytes) / sizeof(FIFONbBytes[0]); i++)
+    BenchFIFOPutGet(FIFONbBytes[i]);
+  for (i = 0; i < sizeof(FIFONbBytes) / sizeof(FIFONbBytes[0]); i++)
+    if (FIFONbBytes[i] <= FIFO_WINDOW_SIZE)
+      BenchFIFOPeekConsume(FIFONbBytes[i]);
+  BenchSlotFIFO(PACKET_SIZE);
+  BenchSlotFIFO(FIFO_SLOT_SIZE);
+
+  for (transport = PACKET_TRANSPORT_RAW; transport <= PACKET_TRANSPORT_COBS; transport++)
+  {
+    BenchPacketPut(transport);
+    for (i = 0; i < sizeof(ByteErrorRates) / sizeof(ByteErrorRates[0]); i++)
+      BenchPacketGet(transport, ByteErrorRates[i]);
+    for (i = 1; i < sizeof(ByteErrorRates) / sizeof(ByteErrorRates[0]); i++)
+    {
+      BenchPacketResync(transport, false, ByteErrorRates[i]);
+      BenchPacketResync(transport, true, ByteErrorRates[i]);
+    }
+  }
+
+  // The table costs the same whichever command is dispatched
+  BenchPacketDispatch("first_command", 0x00, 0);
+  BenchPacketDispatch("last_command", PACKET_NB_COMMANDS - 2, 0);
+  BenchPacketDispatch("acknowledged", (PACKET_NB_COMMANDS - 2) | PACKET_ACK_MASK, 0);
+  BenchPacketDispatch("unknown_command", 0x01, 0);
+  BenchPacketDispatch("invalid_parameters", 0x00, 1);
+  BenchPacketDispatch("mixed", PACKET_NB_COMMANDS, 0);
+
+  for (i = 0; i < sizeof(MedianSizes) / sizeof(MedianSizes[0]); i++)
+    BenchMedian(MedianSizes[i]);
+
+  return 0;
+}
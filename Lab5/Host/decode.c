@@ -0,0 +1,260 @@
+/*! @file
+ *
+ *  @brief Tests of the reference PC decoder against what the packet module sends, run on the host.
+ *
+ *  Frames and packets are put on a link with Packet_PutFrame and Packet_Put. LoopbackUART carries them to the
+ *  receive FIFO, and the bytes are fed one at a time to PCDecoder, which must give back exactly what was sent.
+ *  The "UART - Statistics" reply of Packet_PutUARTStatistics must likewise rebuild to what UART_GetStatistics gave.
+ *
+ *  Usage: decode [number of frames per test, default 100000]
+ *  Exits with 0 if every test passes.
+ *
+ *  @author Group 13, Jacob Dunk (11654718) & Brenton Smith (11380654)
+ *  @date 2016-11-14
+ */
+
+#include "types.h"
+#include "packet.h"
+#include "analog.h"
+#include "CRC.h"
+#include "Cpu.h"
+#include "LoopbackUART.h"
+#include "PCDecoder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Command ID has bit 7 (MSB) reserved for packet acknowledgement, as in main.c
+const uint8_t PACKET_ACK_MASK = 1 << 7;
+
+// A packet interleaved with the frames, as the time packets are on the Tower
+#define DECODE_PACKET_COMMAND 0x0C
+
+// Times the statistics are sent, with enough traffic between them for the byte counts to need their high halves
+#define DECODE_NB_STATISTICS_ROUNDS 1000
+#define DECODE_MAX_PACKETS_PER_ROUND 100
+
+// Chance of each byte of the traffic between the statistics being corrupted, counted as a noise error
+#define DECODE_BYTE_ERROR_RATE 0.01
+
+/*! @brief Gets the next number of the xorshift generator.
+ *
+ *  @param statePtr A pointer to the non-zero generator state.
+ *  @return uint32_t - A pseudorandom number.
+ */
+static uint32_t NextRandom(uint32_t * const statePtr)
+{
+  uint32_t x = *statePtr;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *statePtr = x;
+  return x;
+}
+
+/*! @brief Feeds the bytes waiting in the loopback to the decoder, until it completes a message.
+ *
+ *  @param uart The loopback UART.
+ *  @param decoder The decoder.
+ *  @param messagePtr A pointer to store the address of the message.
+ *  @return uint16_t - The number of bytes in the message, 0 if the bytes ran out first.
+ */
+static uint16_t Receive(TUART * const uart, TPCDecoder * const decoder, const uint8_t ** const messagePtr)
+{
+  while (UART_InNbBytes(uart) != 0)
+  {
+    const uint8_t data = *UART_InPeek(uart, 1);
+    uint16_t nbBytes;
+
+    UART_InConsume(uart, 1);
+    nbBytes = PCDecoder_Put(decoder, data, messagePtr);
+    if (nbBytes != 0)
+      return nbBytes;
+  }
+
+  return 0;
+}
+
+/*! @brief Sends "Analog Input - Frame" frames of random sizes and values, each followed by a packet, and decodes them.
+ *
+ *  The frames are built as Analog_SendFrame builds them, M channels of N samples each.
+ *
+ *  @param name The name of the test, for the results.
+ *  @param transport The transport of the link.
+ *  @param nbFrames The number of frames to send.
+ *  @return bool - TRUE if every frame and packet was decoded as it was sent, with nothing discarded.
+ */
+static bool RunFrameTest(const char * const name, const TPacketTransport transport, const uint32_t nbFrames)
+{
+  static TPacketLink link;
+  TPCDecoder decoder;
+  TPCAnalogFrame frame;
+  int16_t values[ANALOG_FRAME_MAX_NB_SAMPLES * ANALOG_NB_INPUTS];
+  uint8_t payload[PACKET_FRAME_MAX_PAYLOAD];
+  const uint8_t * message;
+  uint32_t random = 0x2468ACE1;
+  uint32_t nbErrors = 0;
+  uint32_t nbBytesSent = 0;
+  uint32_t i;
+
+  (void) Packet_Init(&link, &UART_Port2, 115200, CPU_BUS_CLK_HZ);
+  Packet_SetTransport(&link, transport);
+  PCDecoder_Init(&decoder, transport);
+
+  for (i = 0; i < nbFrames; i++)
+  {
+    const uint8_t nbSamples = 1 + NextRandom(&random) % ANALOG_FRAME_MAX_NB_SAMPLES;
+    const uint8_t sequenceNb = (uint8_t) i;
+    uint8_t nbBytes = 0;
+    uint16_t nbReceived;
+    uint8_t j;
+
+    payload[nbBytes++] = ANALOG_NB_INPUTS;
+    payload[nbBytes++] = nbSamples;
+    payload[nbBytes++] = sequenceNb;
+
+    for (j = 0; j < nbSamples * ANALOG_NB_INPUTS; j++)
+    {
+      values[j] = (int16_t) NextRandom(&random);
+      payload[nbBytes++] = (uint8_t) values[j];
+      payload[nbBytes++] = (uint8_t)((uint16_t) values[j] >> 8);
+    }
+
+    if (!Packet_PutFrame(&link, UART_TX_TELEMETRY, ANALOG_COMMAND_FRAME, payload, nbBytes)
+        || !Packet_Put(&link, DECODE_PACKET_COMMAND, (uint8_t) i, ANALOG_COMMAND_FRAME, nbSamples))
+    {
+      nbErrors++;
+      continue;
+    }
+
+    nbBytesSent += UART_InNbBytes(&UART_Port2);
+
+    // The frame, values and all
+    nbReceived = Receive(&UART_Port2, &decoder, &message);
+    if (!PCDecoder_AnalogFrame(message, nbReceived, &frame) || frame.NbChannels != ANALOG_NB_INPUTS
+        || frame.NbSamples != nbSamples || frame.SequenceNb != sequenceNb
+        || memcmp(frame.Values, values, nbSamples * ANALOG_NB_INPUTS * sizeof(int16_t)) != 0)
+      nbErrors++;
+
+    // Then the packet, which may look like a frame header
+    nbReceived = Receive(&UART_Port2, &decoder, &message);
+    if (nbReceived != PACKET_NB_DATA_BYTES || message[0] != DECODE_PACKET_COMMAND || message[1] != (uint8_t) i
+        || message[2] != ANALOG_COMMAND_FRAME || message[3] != nbSamples)
+      nbErrors++;
+
+    // Nothing is left over
+    if (UART_InNbBytes(&UART_Port2) != 0)
+    {
+      nbErrors++;
+      Loopback_Clear(&UART_Port2);
+    }
+  }
+
+  const bool passed = nbErrors == 0 && decoder.NbDiscarded == 0;
+
+  printf("%s %s: %u frames and packets, %u bytes, %u not decoded as sent, %u discarded\n", passed ? "PASS" : "FAIL",
+      name, nbFrames, nbBytesSent, nbErrors, decoder.NbDiscarded);
+  return passed;
+}
+
+/*! @brief Sends "UART - Statistics" replies between bursts of corrupted traffic, and rebuilds them.
+ *
+ *  @param name The name of the test, for the results.
+ *  @param transport The transport of the link.
+ *  @return bool - TRUE if every reply rebuilt to the UART_GetStatistics snapshot taken just before it was sent.
+ */
+static bool RunStatisticsTest(const char * const name, const TPacketTransport transport)
+{
+  static TPacketLink link;
+  TPCDecoder decoder;
+  TPCUARTStatistics received;
+  TUARTStatistics expected;
+  const uint8_t * message;
+  uint32_t random = 0x13579BDF;
+  uint32_t nbErrors = 0;
+  uint32_t round;
+
+  (void) Packet_Init(&link, &UART_Port2, 115200, CPU_BUS_CLK_HZ);
+  Packet_SetTransport(&link, transport);
+  PCDecoder_Init(&decoder, transport);
+
+  for (round = 0; round < DECODE_NB_STATISTICS_ROUNDS; round++)
+  {
+    const uint32_t nbPackets = 1 + NextRandom(&random) % DECODE_MAX_PACKETS_PER_ROUND;
+    uint8_t payload[PACKET_FRAME_MAX_PAYLOAD];
+    uint16_t nbReceived;
+    uint32_t i;
+
+    // Traffic the PC never reads, of packets and frames so the modelled ISR times vary
+    Loopback_SetErrorRate(&UART_Port2, DECODE_BYTE_ERROR_RATE, round + 1);
+    for (i = 0; i < nbPackets; i++)
+    {
+      const uint32_t value = NextRandom(&random);
+
+      if (value & 1)
+        (void) Packet_Put(&link, DECODE_PACKET_COMMAND, (uint8_t) value, (uint8_t)(value >> 8), (uint8_t)(value >> 16));
+      else
+      {
+        memset(payload, (uint8_t) value, sizeof(payload));
+        (void) Packet_PutFrame(&link, UART_TX_TELEMETRY, DECODE_PACKET_COMMAND, payload, 1 + (value >> 8) % PACKET_FRAME_MAX_PAYLOAD);
+      }
+
+      Loopback_Clear(&UART_Port2);
+    }
+    Loopback_SetErrorRate(&UART_Port2, 0.0, 1);
+
+    // The reply is of the statistics as they were before it was sent
+    UART_GetStatistics(&UART_Port2, &expected);
+    if (!Packet_PutUARTStatistics(&link))
+      nbErrors++;
+
+    PCDecoder_UARTStatisticsInit(&received);
+    while ((nbReceived = Receive(&UART_Port2, &decoder, &message)) != 0)
+      if (!PCDecoder_UARTStatistic(&received, message, nbReceived))
+        nbErrors++;
+
+    const uint32_t avgISRCycles = (expected.NbInterrupts != 0) ? (uint32_t) (expected.TotalISRCycles / expected.NbInterrupts) : 0;
+
+    if (!PCDecoder_UARTStatisticsComplete(&received)
+        || PCDecoder_UARTStatisticValue(&received, UART_STATISTIC_NB_RX_BYTES) != expected.NbRxBytes
+        || PCDecoder_UARTStatisticValue(&received, UART_STATISTIC_NB_TX_BYTES) != expected.NbTxBytes
+        || PCDecoder_UARTStatisticValue(&received, UART_STATISTIC_NB_OVERRUNS) != expected.NbOverruns
+        || PCDecoder_UARTStatisticValue(&received, UART_STATISTIC_NB_NOISE_ERRORS) != expected.NbNoiseErrors
+        || PCDecoder_UARTStatisticValue(&received, UART_STATISTIC_NB_FRAMING_ERRORS) != expected.NbFramingErrors
+        || PCDecoder_UARTStatisticValue(&received, UART_STATISTIC_NB_PARITY_ERRORS) != expected.NbParityErrors
+        || PCDecoder_UARTStatisticValue(&received, UART_STATISTIC_NB_RX_UNDERFLOWS) != expected.NbRxUnderflows
+        || PCDecoder_UARTStatisticValue(&received, UART_STATISTIC_NB_TX_OVERFLOWS) != expected.NbTxOverflows
+        || PCDecoder_UARTStatisticValue(&received, UART_STATISTIC_NB_INTERRUPTS) != expected.NbInterrupts
+        || PCDecoder_UARTStatisticValue(&received, UART_STATISTIC_MIN_ISR_CYCLES) != expected.MinISRCycles
+        || PCDecoder_UARTStatisticValue(&received, UART_STATISTIC_AVG_ISR_CYCLES) != avgISRCycles
+        || PCDecoder_UARTStatisticValue(&received, UART_STATISTIC_MAX_ISR_CYCLES) != expected.MaxISRCycles
+        || PCDecoder_AvgISRMicroseconds(&received, CPU_CORE_CLK_HZ) != avgISRCycles * 1e6 / CPU_CORE_CLK_HZ)
+      nbErrors++;
+  }
+
+  const bool passed = nbErrors == 0 && decoder.NbDiscarded == 0;
+
+  printf("%s %s: %u replies, last of %u bytes sent, %u noise errors, %u interrupts averaging %.2f us, %u not rebuilt as sent\n",
+      passed ? "PASS" : "FAIL", name, DECODE_NB_STATISTICS_ROUNDS, expected.NbTxBytes, expected.NbNoiseErrors,
+      expected.NbInterrupts, PCDecoder_AvgISRMicroseconds(&received, CPU_CORE_CLK_HZ), nbErrors);
+  return passed;
+}
+
+int main(int argc, char * argv[])
+{
+  uint32_t nbFrames = 100000;
+  bool passed = true;
+
+  if (argc > 1)
+    nbFrames = strtoul(argv[1], NULL, 10);
+
+  (void) CRC_Init();
+
+  passed = RunFrameTest("analog_frame_raw", PACKET_TRANSPORT_RAW, nbFrames) && passed;
+  passed = RunFrameTest("analog_frame_cobs", PACKET_TRANSPORT_COBS, nbFrames) && passed;
+  passed = RunStatisticsTest("uart_statistics_raw", PACKET_TRANSPORT_RAW) && passed;
+  passed = RunStatisticsTest("uart_statistics_cobs", PACKET_TRANSPORT_COBS) && passed;
+
+  return passed ? 0 : 1;
+}
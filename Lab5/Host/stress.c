@@ -0,0 +1,384 @@
+/*! @file
+ *
+ *  @brief Multi-threaded stress tests of the lock-free FIFOs, run on the host.
+ *
+ *  A producer thread and a consumer thread stream numbered elements through a small FIFO, in batches of
+ *  varying size, long enough for the buffer to wrap many times and the free running indices to wrap too.
+ *  The consumer checks that every element arrives, once and in order. On the host the FIFOs use their
+ *  portable fallbacks, __sync_synchronize for the memory barrier and __sync_bool_compare_and_swap.
+ *
+ *  Usage: stress [number of elements per test, default 4000000]
+ *  Exits with 0 if every test passes.
+ *
+ *  @author Group 13, Jacob Dunk (11654718) & Brenton Smith (11380654)
+ *  @date 2016-11-14
+ */
+
+#define _GNU_SOURCE
+
+#include "types.h"
+#include "FIFO.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// A FIFO small enough to wrap constantly, with a window so Peek and Reserve cross the wrap point too
+#define STRESS_FIFO_SIZE 16
+#define STRESS_WINDOW_SIZE 4
+
+FIFO_DEFINE(StressFIFO, uint32_t, STRESS_FIFO_SIZE, STRESS_WINDOW_SIZE)
+
+// Largest batch moved at once. A consumer waiting for more than is stored while the producer waits for more
+// room than is free would deadlock, which batches of up to half the FIFO can never do
+#define STRESS_MAX_BATCH (STRESS_FIFO_SIZE / 2)
+
+// Slots in the slot FIFO, and the producers that share it
+#define STRESS_NB_SLOTS 4
+#define STRESS_NB_PRODUCERS 2
+
+/*!
+ * @enum TStressMode
+ *
+ * Which operations a test moves the elements with.
+ */
+typedef enum
+{
+  STRESS_SPIN,      /*!< TryPutN and GetN, retried until they succeed */
+  STRESS_BLOCKING,  /*!< BlockingPutN and BlockingGetN, which wait on the FIFO semaphores */
+  STRESS_IN_PLACE   /*!< Reserve/Commit and Peek/Consume, within the window */
+} TStressMode;
+
+/*!
+ * @struct TStressTest
+ *
+ * A test of the FIFO shared by its producer and consumer threads.
+ */
+typedef struct
+{
+  TStressFIFO FIFO;       /*!< The FIFO under test */
+  TStressMode Mode;       /*!< The operations used */
+  uint32_t NbElements;    /*!< The number of elements to stream */
+  uint32_t NbErrors;      /*!< Elements the consumer got out of order */
+  uint32_t NbReceived;    /*!< Elements the consumer got */
+} TStressTest;
+
+/*!
+ * @struct TSlotStressTest
+ *
+ * A test of the slot FIFO shared by its producer threads and consumer thread.
+ */
+typedef struct
+{
+  TSlotFIFO FIFO;                         /*!< The slot FIFO under test */
+  TFIFOSlot Slots[STRESS_NB_SLOTS];       /*!< Its storage */
+  uint32_t NbMessages;                    /*!< The number of messages each producer sends */
+  uint32_t NbErrors;                      /*!< Messages the consumer got out of order or corrupted */
+  uint32_t NbReceived[STRESS_NB_PRODUCERS]; /*!< Messages the consumer got from each producer */
+} TSlotStressTest;
+
+/*!
+ * @struct TSlotProducer
+ *
+ * One producer of a slot FIFO test.
+ */
+typedef struct
+{
+  TSlotStressTest * Test; /*!< The test */
+  uint8_t Id;             /*!< The producer's number, sent in each of its messages */
+} TSlotProducer;
+
+/*! @brief Gets the next number of the xorshift generator.
+ *
+ *  @param statePtr A pointer to the non-zero generator state.
+ *  @return uint32_t - A pseudorandom number.
+ */
+static uint32_t NextRandom(uint32_t * const statePtr)
+{
+  uint32_t x = *statePtr;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *statePtr = x;
+  return x;
+}
+
+/*! @brief Puts the numbers 0 to NbElements - 1 in batches of random size.
+ *
+ *  @param arg The TStressTest.
+ *  @return void* - NULL.
+ */
+static void * Producer(void * arg)
+{
+  TStressTest * const test = arg;
+  uint32_t random = 0x12345678;
+  uint32_t batch[STRESS_FIFO_SIZE];
+  uint32_t next = 0;
+
+  while (next < test->NbElements)
+  {
+    const uint16_t maxNbElements = (test->Mode == STRESS_IN_PLACE) ? STRESS_WINDOW_SIZE : STRESS_MAX_BATCH;
+    uint16_t nbElements = 1 + NextRandom(&random) % maxNbElements;
+    uint16_t i;
+
+    if (nbElements > test->NbElements - next)
+      nbElements = test->NbElements - next;
+
+    if (test->Mode == STRESS_IN_PLACE)
+    {
+      uint32_t * dataPtr;
+
+      while (!(dataPtr = StressFIFO_Reserve(&test->FIFO, nbElements)))
+        sched_yield();
+
+      for (i = 0; i < nbElements; i++)
+        dataPtr[i] = next + i;
+      StressFIFO_Commit(&test->FIFO, nbElements);
+    }
+    else
+    {
+      for (i = 0; i < nbElements; i++)
+        batch[i] = next + i;
+
+      if (test->Mode == STRESS_BLOCKING)
+        StressFIFO_BlockingPutN(&test->FIFO, batch, nbElements);
+      else
+        while (!StressFIFO_TryPutN(&test->FIFO, batch, nbElements))
+          sched_yield();
+    }
+
+    next += nbElements;
+  }
+
+  return NULL;
+}
+
+/*! @brief Gets the elements in batches of random size, checking each is the next number.
+ *
+ *  @param arg The TStressTest.
+ *  @return void* - NULL.
+ */
+static void * Consumer(void * arg)
+{
+  TStressTest * const test = arg;
+  uint32_t random = 0x9ABCDEF0;
+  uint32_t batch[STRESS_FIFO_SIZE];
+
+  while (test->NbReceived < test->NbElements)
+  {
+    const uint16_t maxNbElements = (test->Mode == STRESS_IN_PLACE) ? STRESS_WINDOW_SIZE : STRESS_MAX_BATCH;
+    uint16_t nbElements = 1 + NextRandom(&random) % maxNbElements;
+    const uint32_t * dataPtr = batch;
+    uint16_t i;
+
+    if (nbElements > test->NbElements - test->NbReceived)
+      nbElements = test->NbElements - test->NbReceived;
+
+    if (test->Mode == STRESS_IN_PLACE)
+    {
+      while (!(dataPtr = StressFIFO_Peek(&test->FIFO, nbElements)))
+        sched_yield();
+    }
+    else if (test->Mode == STRESS_BLOCKING)
+    {
+      StressFIFO_BlockingGetN(&test->FIFO, batch, nbElements);
+    }
+    else
+    {
+      while (!StressFIFO_GetN(&test->FIFO, batch, nbElements))
+        sched_yield();
+    }
+
+    for (i = 0; i < nbElements; i++)
+      if (dataPtr[i] != test->NbReceived + i)
+        test->NbErrors++;
+
+    if (test->Mode == STRESS_IN_PLACE)
+      StressFIFO_Consume(&test->FIFO, nbElements);
+
+    test->NbReceived += nbElements;
+  }
+
+  return NULL;
+}
+
+/*! @brief Streams elements through the FIFO from one thread to another.
+ *
+ *  @param name The name of the test, for the results.
+ *  @param mode The operations to use.
+ *  @param nbElements The number of elements to stream.
+ *  @return bool - TRUE if every element arrived once and in order.
+ */
+static bool RunTest(const char * const name, const TStressMode mode, const uint32_t nbElements)
+{
+  static TStressTest test;
+  TFIFOStatistics statistics;
+  pthread_t producer, consumer;
+
+  StressFIFO_Init(&test.FIFO);
+  test.Mode = mode;
+  test.NbElements = nbElements;
+  test.NbErrors = 0;
+  test.NbReceived = 0;
+
+  (void) pthread_create(&consumer, NULL, Consumer, &test);
+  (void) pthread_create(&producer, NULL, Producer, &test);
+  (void) pthread_join(producer, NULL);
+  (void) pthread_join(consumer, NULL);
+
+  (void) StressFIFO_GetStatistics(&test.FIFO, &statistics);
+
+  // Everything put was got, and the FIFO is left empty
+  const bool passed = test.NbErrors == 0 && test.NbReceived == nbElements && StressFIFO_NbElements(&test.FIFO) == 0
+      && statistics.NbDropped == 0;
+
+  printf("%s %s: %u elements, %u out of order, %u wraps of the indices\n", passed ? "PASS" : "FAIL", name,
+      test.NbReceived, test.NbErrors, (unsigned)(nbElements >> 16));
+  return passed;
+}
+
+/*! @brief Sends NbMessages messages, each holding the producer's number and the message's number.
+ *
+ *  The messages vary in length, with every byte after the numbers derived from them.
+ *
+ *  @param arg The TSlotProducer.
+ *  @return void* - NULL.
+ */
+static void * SlotProducer(void * arg)
+{
+  const TSlotProducer * const producer = arg;
+  TSlotStressTest * const test = producer->Test;
+  uint32_t sequence;
+
+  for (sequence = 0; sequence < test->NbMessages; sequence++)
+  {
+    // Waits for a free slot
+    uint8_t * const slotPtr = FIFO_SlotReserve(&test->FIFO, 0);
+    const uint8_t nbBytes = 5 + sequence % (FIFO_SLOT_SIZE - 4);
+    uint8_t i;
+
+    slotPtr[0] = producer->Id;
+    memcpy(&slotPtr[1], &sequence, sizeof(sequence));
+    for (i = 5; i < nbBytes; i++)
+      slotPtr[i] = (uint8_t)(sequence + i);
+    FIFO_SlotCommit(&test->FIFO, slotPtr, nbBytes);
+  }
+
+  return NULL;
+}
+
+/*! @brief Receives the messages of every producer, alternating between whole messages and single bytes.
+ *
+ *  @param arg The TSlotStressTest.
+ *  @return void* - NULL.
+ */
+static void * SlotConsumer(void * arg)
+{
+  TSlotStressTest * const test = arg;
+  const uint32_t nbMessages = test->NbMessages * STRESS_NB_PRODUCERS;
+  uint32_t nbReceived;
+
+  for (nbReceived = 0; nbReceived < nbMessages; nbReceived++)
+  {
+    uint8_t message[FIFO_SLOT_SIZE];
+    uint8_t nbBytes = 0;
+    uint32_t sequence;
+    uint8_t i;
+
+    if (nbReceived % 2 == 0)
+    {
+      const uint8_t * slotPtr;
+
+      while (!(slotPtr = FIFO_SlotGetAll(&test->FIFO, &nbBytes)))
+        sched_yield();
+
+      memcpy(message, slotPtr, nbBytes);
+      FIFO_SlotRelease(&test->FIFO);
+    }
+    else
+    {
+      // A message ends when the consumer moves on to the next slot
+      do
+      {
+        while (!FIFO_SlotGet(&test->FIFO, &message[nbBytes]))
+          sched_yield();
+        nbBytes++;
+      } while (FIFO_SlotIsGetting(&test->FIFO));
+    }
+
+    const uint8_t id = message[0];
+
+    memcpy(&sequence, &message[1], sizeof(sequence));
+
+    // Each producer's messages arrive whole and in order
+    bool valid = id < STRESS_NB_PRODUCERS && sequence == test->NbReceived[id] && nbBytes == 5 + sequence % (FIFO_SLOT_SIZE - 4);
+
+    for (i = 5; valid && i < nbBytes; i++)
+      valid = message[i] == (uint8_t)(sequence + i);
+
+    if (!valid)
+      test->NbErrors++;
+    if (id < STRESS_NB_PRODUCERS)
+      test->NbReceived[id]++;
+  }
+
+  return NULL;
+}
+
+/*! @brief Sends messages through the slot FIFO from several threads to one.
+ *
+ *  @param nbMessages The number of messages each producer sends.
+ *  @return bool - TRUE if every message arrived whole, once and in order.
+ */
+static bool RunSlotTest(const uint32_t nbMessages)
+{
+  static TSlotStressTest test;
+  TSlotProducer producers[STRESS_NB_PRODUCERS];
+  pthread_t producerThreads[STRESS_NB_PRODUCERS], consumer;
+  uint8_t id;
+  bool passed;
+
+  FIFO_SlotInit(&test.FIFO, test.Slots, STRESS_NB_SLOTS);
+  test.NbMessages = nbMessages;
+  test.NbErrors = 0;
+  memset(test.NbReceived, 0, sizeof(test.NbReceived));
+
+  (void) pthread_create(&consumer, NULL, SlotConsumer, &test);
+  for (id = 0; id < STRESS_NB_PRODUCERS; id++)
+  {
+    producers[id].Test = &test;
+    producers[id].Id = id;
+    (void) pthread_create(&producerThreads[id], NULL, SlotProducer, &producers[id]);
+  }
+  for (id = 0; id < STRESS_NB_PRODUCERS; id++)
+    (void) pthread_join(producerThreads[id], NULL);
+  (void) pthread_join(consumer, NULL);
+
+  passed = test.NbErrors == 0;
+  for (id = 0; id < STRESS_NB_PRODUCERS; id++)
+    passed = passed && test.NbReceived[id] == nbMessages;
+
+  // Every claimed slot was released
+  passed = passed && test.FIFO.Claimed == test.FIFO.Start;
+
+  printf("%s slot_fifo_mpsc: %u producers x %u messages, %u out of order or corrupted\n", passed ? "PASS" : "FAIL",
+      STRESS_NB_PRODUCERS, nbMessages, test.NbErrors);
+  return passed;
+}
+
+int main(int argc, char * argv[])
+{
+  uint32_t nbElements = 4000000;
+  bool passed = true;
+
+  if (argc > 1)
+    nbElements = strtoul(argv[1], NULL, 10);
+
+  passed = RunTest("fifo_spsc_spin", STRESS_SPIN, nbElements) && passed;
+  passed = RunTest("fifo_spsc_blocking", STRESS_BLOCKING, nbElements / 4) && passed;
+  passed = RunTest("fifo_spsc_in_place", STRESS_IN_PLACE, nbElements) && passed;
+  passed = RunSlotTest(nbElements / 8) && passed;
+
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,304 @@
+/*! @file
+ *
+ *  @brief Register model test of the UART2 transmit DMA path, run on the host.
+ *
+ *  UART.c is compiled against Model/MK70F12.h, so its UART, DMA and DMAMUX registers are ordinary variables.
+ *  The test plays the hardware: when the ISR enables the transmit channel it checks the transfer control descriptor,
+ *  runs the major loop out of the slot the descriptor points at, then sets DONE and Transmission Complete.
+ *  Messages of random length and class are committed in between, until every slot ring has wrapped many times
+ *  and the free running slot indices have wrapped too. Each transfer must send the oldest message of the highest
+ *  class waiting, whole, and its slot must not be handed back or overwritten until the channel is done with it.
+ *  The ISR is also called while Transmission Complete is still set before the channel has written its first byte,
+ *  which must not end the transfer.
+ *
+ *  Usage: txdma [number of messages, default 1000000]
+ *  Exits with 0 if the test passes.
+ *
+ *  @author Group 13, Jacob Dunk (11654718) & Brenton Smith (11380654)
+ *  @date 2016-11-14
+ */
+
+#include "types.h"
+#include "UART.h"
+#include "MK70F12.h"
+#include "Cpu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The UART2 transmit channel and request source, as in UART.c
+#define TXDMA_CHANNEL 0
+#define TXDMA_SOURCE 7
+
+// Written to the DMA set/clear registers before each interrupt, to see whether the ISR wrote them
+#define TXDMA_NOT_WRITTEN 0xFF
+
+// The most slots of any class
+#define TXDMA_MAX_SLOTS 32
+
+// The errors printed before giving up, as the model and the driver may never agree again
+#define TXDMA_MAX_ERRORS 10
+
+// The modelled peripherals
+volatile struct UART_MemMap Model_UART2;
+volatile struct DMA_MemMap Model_DMA;
+volatile struct DMAMUX_MemMap Model_DMAMUX0;
+volatile struct SIM_MemMap Model_SIM;
+volatile struct PORT_MemMap Model_PORTE;
+volatile struct GPIO_MemMap Model_PTE;
+volatile struct NVIC_MemMap Model_NVIC;
+volatile struct DWT_MemMap Model_DWT;
+volatile struct CoreDebug_MemMap Model_CoreDebug;
+
+// The number of slots of each class, as in UART.c
+static const uint16_t NbSlots[UART_NB_TX_CLASSES] = { 8, 4, 32 };
+
+/*!
+ * @struct TMessage
+ *
+ * A message as committed.
+ */
+typedef struct
+{
+  uint8_t NbBytes;                /*!< The length of the message */
+  uint8_t Bytes[FIFO_SLOT_SIZE];  /*!< The message */
+} TMessage;
+
+/*!
+ * @struct TModel
+ *
+ * What the driver should do next, and what it has done wrong.
+ */
+typedef struct
+{
+  TMessage Waiting[UART_NB_TX_CLASSES][TXDMA_MAX_SLOTS];  /*!< The messages committed but not yet started, per class */
+  uint16_t WaitingStart[UART_NB_TX_CLASSES];              /*!< The index of the oldest waiting message of each class */
+  uint16_t NbWaiting[UART_NB_TX_CLASSES];                 /*!< The number of waiting messages of each class */
+  uint16_t NbHeld[UART_NB_TX_CLASSES];                    /*!< The slots in use per class, waiting or being sent */
+  TMessage Sending;                                       /*!< The message the channel was started on */
+  TUARTTxClass SendingClass;                              /*!< The class of that message */
+  bool Busy;                                              /*!< TRUE from starting the channel until it is cleared */
+  bool Done;                                              /*!< TRUE once the major loop has run */
+  uint32_t NbCommitted;                                   /*!< Messages committed */
+  uint32_t NbSent;                                        /*!< Messages sent */
+  uint32_t NbBytes;                                       /*!< Bytes sent */
+  uint32_t NbGuarded;                                     /*!< Interrupts taken before the first byte was written */
+  uint32_t NbErrors;                                      /*!< Checks that failed */
+  uint32_t Random;                                        /*!< The xorshift generator state */
+} TModel;
+
+static TModel Model;
+
+/*! @brief Gets the next number of the xorshift generator.
+ *
+ *  @param statePtr A pointer to the non-zero generator state.
+ *  @return uint32_t - A pseudorandom number.
+ */
+static uint32_t NextRandom(uint32_t * const statePtr)
+{
+  uint32_t x = *statePtr;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *statePtr = x;
+  return x;
+}
+
+/*! @brief Counts a failed check, printing it.
+ *
+ *  @param passed Whether the check passed.
+ *  @param what What was checked.
+ */
+static void Expect(const bool passed, const char * const what)
+{
+  if (passed)
+    return;
+
+  fprintf(stderr, "message %u: expected %s\n", Model.NbSent, what);
+  Model.NbErrors++;
+}
+
+/*! @brief Checks the parts of the transmit channel's descriptor and request routing that UART_Init sets once. */
+static void CheckSetup(void)
+{
+  Expect(DMA_DADDR(TXDMA_CHANNEL) == (uint32_t)(uintptr_t) &UART_D_REG(UART2_BASE_PTR), "DADDR to be UART2_D");
+  Expect(DMA_DOFF(TXDMA_CHANNEL) == 0 && DMA_DLAST_SGA(TXDMA_CHANNEL) == 0, "the destination not to move");
+  Expect(DMA_SOFF(TXDMA_CHANNEL) == 1 && DMA_SLAST(TXDMA_CHANNEL) == 0, "the source to step a byte at a time");
+  Expect(DMA_ATTR(TXDMA_CHANNEL) == (DMA_ATTR_SSIZE(0) | DMA_ATTR_DSIZE(0)), "byte transfers");
+  Expect(DMA_NBYTES_MLNO(TXDMA_CHANNEL) == 1, "a byte per request");
+  Expect(DMA_CSR(TXDMA_CHANNEL) & DMA_CSR_DREQ_MASK, "the channel to stop at the end of each message");
+  Expect(DMAMUX0_CHCFG(TXDMA_CHANNEL) == (DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(TXDMA_SOURCE)),
+      "the channel routed to the UART2 transmitter");
+  Expect(UART_C5_REG(UART2_BASE_PTR) & UART_C5_TDMAS_MASK, "Transmit Empty to request DMA");
+}
+
+/*! @brief Commits a message of random length to a class with a free slot.
+ *
+ *  @param txClass The class.
+ */
+static void Commit(const TUARTTxClass txClass)
+{
+  TMessage * const message = &Model.Waiting[txClass][(Model.WaitingStart[txClass] + Model.NbWaiting[txClass]) % TXDMA_MAX_SLOTS];
+  uint8_t * const dataPtr = UART_OutReserve(&UART_Port2, txClass, 1);
+  uint8_t index;
+
+  Expect(dataPtr != NULL, "a free slot");
+  if (!dataPtr)
+    return;
+
+  message->NbBytes = 1 + NextRandom(&Model.Random) % FIFO_SLOT_SIZE;
+  for (index = 0; index < message->NbBytes; index++)
+    message->Bytes[index] = (uint8_t) NextRandom(&Model.Random);
+
+  memcpy(dataPtr, message->Bytes, message->NbBytes);
+  UART_OutCommit(&UART_Port2, txClass, dataPtr, message->NbBytes);
+
+  Model.NbWaiting[txClass]++;
+  Model.NbHeld[txClass]++;
+  Model.NbCommitted++;
+  Expect(UART_C2_REG(UART2_BASE_PTR) & UART_C2_TCIE_MASK, "a commit to enable Transmit Complete Interrupts");
+}
+
+/*! @brief Calls the ISR, then checks what it did to the transmit channel against what it should have done. */
+static void Interrupt(void)
+{
+  const bool serviced = (UART_C2_REG(UART2_BASE_PTR) & UART_C2_TCIE_MASK) && (UART_S1_REG(UART2_BASE_PTR) & UART_S1_TC_MASK);
+  const bool release = serviced && Model.Busy && Model.Done;
+  const bool start = serviced && (!Model.Busy || Model.Done);
+  TUARTTxClass txClass;
+
+  if (serviced && Model.Busy && !Model.Done)
+    Model.NbGuarded++;
+
+  DMA_SERQ = TXDMA_NOT_WRITTEN;
+  DMA_CDNE = TXDMA_NOT_WRITTEN;
+  UART_ISR();
+
+  // Finishing a transfer clears DONE and hands the slot back
+  if (release)
+  {
+    Expect(DMA_CDNE == DMA_CDNE_CDNE(TXDMA_CHANNEL), "DONE cleared once the message was sent");
+    Model.NbHeld[Model.SendingClass]--;
+    Model.Busy = false;
+    Model.Done = false;
+  }
+  else
+    Expect(DMA_CDNE == TXDMA_NOT_WRITTEN, "DONE left alone while the channel is running or idle");
+
+  if (DMA_CDNE == DMA_CDNE_CDNE(TXDMA_CHANNEL))
+    DMA_CSR(TXDMA_CHANNEL) &= ~DMA_CSR_DONE_MASK;
+
+  if (!start)
+  {
+    Expect(DMA_SERQ == TXDMA_NOT_WRITTEN, "the channel not started again");
+    return;
+  }
+
+  // The oldest message of the highest class waiting goes next
+  for (txClass = UART_TX_CONTROL; txClass < UART_NB_TX_CLASSES && Model.NbWaiting[txClass] == 0; txClass++)
+    ;
+
+  if (txClass == UART_NB_TX_CLASSES)
+  {
+    Expect(DMA_SERQ == TXDMA_NOT_WRITTEN, "the channel left idle with nothing to send");
+    Expect(!(UART_C2_REG(UART2_BASE_PTR) & UART_C2_TCIE_MASK), "Transmit Complete Interrupts disabled with nothing to send");
+    return;
+  }
+
+  Expect(DMA_SERQ == DMA_SERQ_SERQ(TXDMA_CHANNEL), "the channel started on the next message");
+  if (DMA_SERQ != DMA_SERQ_SERQ(TXDMA_CHANNEL))
+    return;
+
+  Model.Sending = Model.Waiting[txClass][Model.WaitingStart[txClass]];
+  Model.SendingClass = txClass;
+  Model.WaitingStart[txClass] = (Model.WaitingStart[txClass] + 1) % TXDMA_MAX_SLOTS;
+  Model.NbWaiting[txClass]--;
+  Model.Busy = true;
+
+  Expect(DMA_CITER_ELINKNO(TXDMA_CHANNEL) == Model.Sending.NbBytes, "CITER to be the message length");
+  Expect(DMA_BITER_ELINKNO(TXDMA_CHANNEL) == Model.Sending.NbBytes, "BITER to be the message length");
+  Expect(!(DMA_CSR(TXDMA_CHANNEL) & DMA_CSR_DONE_MASK), "DONE clear when the channel is started");
+}
+
+/*! @brief Runs the major loop of the started channel, and lets the transmitter go idle. */
+static void Transfer(void)
+{
+  const uint8_t * const dataPtr = (const uint8_t *)(uintptr_t) DMA_SADDR(TXDMA_CHANNEL);
+  const uint16_t nbBytes = DMA_CITER_ELINKNO(TXDMA_CHANNEL);
+
+  // The slot may have been reused while the channel waited, if it was handed back early
+  Expect(nbBytes == Model.Sending.NbBytes && memcmp(dataPtr, Model.Sending.Bytes, nbBytes) == 0,
+      "the slot to hold the oldest message of the highest class waiting");
+
+  Model.NbSent++;
+  Model.NbBytes += nbBytes;
+  Model.Done = true;
+  DMA_CSR(TXDMA_CHANNEL) |= DMA_CSR_DONE_MASK;
+  UART_S1_REG(UART2_BASE_PTR) |= UART_S1_TC_MASK;
+}
+
+int main(int argc, char * argv[])
+{
+  uint32_t nbMessages = 1000000;
+  TUARTStatistics statistics;
+  TUARTTxClass txClass;
+  bool passed;
+
+  if (argc > 1)
+    nbMessages = strtoul(argv[1], NULL, 10);
+
+  Model.Random = 0x12345678;
+  UART_S1_REG(UART2_BASE_PTR) = UART_S1_TDRE_MASK | UART_S1_TC_MASK;
+
+  if (!UART_Init(&UART_Port2, 115200, CPU_BUS_CLK_HZ))
+  {
+    printf("FAIL uart_tx_dma: UART_Init failed\n");
+    return 1;
+  }
+
+  CheckSetup();
+
+  while (Model.NbErrors < TXDMA_MAX_ERRORS && (Model.NbCommitted < nbMessages || Model.Busy
+      || Model.NbWaiting[UART_TX_CONTROL] > 0 || Model.NbWaiting[UART_TX_TIME] > 0 || Model.NbWaiting[UART_TX_TELEMETRY] > 0))
+  {
+    switch (NextRandom(&Model.Random) % 4)
+    {
+      // Commit to a class with a free slot, counting the one being sent from
+      case 0:
+      case 1:
+        txClass = (TUARTTxClass)(NextRandom(&Model.Random) % UART_NB_TX_CLASSES);
+        if (Model.NbCommitted < nbMessages && Model.NbHeld[txClass] < NbSlots[txClass])
+          Commit(txClass);
+        break;
+
+      // Transmission Complete stays set until the channel writes the first byte, so the ISR may see it again
+      case 2:
+        Interrupt();
+        if (Model.Busy && !Model.Done)
+        {
+          if (NextRandom(&Model.Random) % 2)
+            Interrupt();
+          UART_S1_REG(UART2_BASE_PTR) &= ~UART_S1_TC_MASK;
+        }
+        break;
+
+      case 3:
+        if (Model.Busy && !Model.Done)
+          Transfer();
+        break;
+    }
+  }
+
+  // The last transfer is handed back, and Transmit Complete Interrupts turned off
+  Interrupt();
+  Expect(!Model.Busy, "the last slot handed back");
+
+  UART_GetStatistics(&UART_Port2, &statistics);
+  Expect(statistics.NbTxBytes == Model.NbBytes, "NbTxBytes to count every byte sent");
+
+  passed = Model.NbErrors == 0 && Model.NbSent == nbMessages;
+  printf("%s uart_tx_dma: %u messages, %u bytes, %u interrupts before the first byte, %u errors\n",
+      passed ? "PASS" : "FAIL", Model.NbSent, Model.NbBytes, Model.NbGuarded, Model.NbErrors);
+  return passed ? 0 : 1;
+}
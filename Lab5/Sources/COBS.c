@@ -0,0 +1,104 @@
+/*! @file
+ *
+ *  @brief Consistent Overhead Byte Stuffing (COBS) framing.
+ *
+ *  This contains the implementation of COBS encoding, and of decoding a byte at a time.
+ *
+ *  @author Group 13, Jacob Dunk (11654718) & Brenton Smith (11380654)
+ *  @date 2016-11-07
+ */
+/*!
+ * @addtogroup COBS_module COBS module documentation
+ * @{
+ */
+/* MODULE COBS */
+
+#include "COBS.h"
+
+// The code of a block of 254 data bytes with no zero after it
+#define COBS_MAX_CODE 0xFF
+
+uint16_t COBS_Encode(const uint8_t data[], const uint16_t nbBytes, uint8_t encoded[])
+{
+  uint16_t codeIndex = 0; // Where the code byte of the current block goes
+  uint16_t nbEncoded = 1;
+  uint8_t code = 1;
+
+  // Each block is a code byte, then up to 254 non-zero bytes. The code is one more than the number of bytes,
+  // and every block but a full one stands for its bytes followed by a zero
+  for (uint16_t i = 0; i < nbBytes; i++)
+  {
+    if (data[i] != 0)
+    {
+      encoded[nbEncoded++] = data[i];
+      code++;
+    }
+
+    if (data[i] == 0 || code == COBS_MAX_CODE)
+    {
+      encoded[codeIndex] = code;
+      codeIndex = nbEncoded++;
+      code = 1;
+    }
+  }
+
+  encoded[codeIndex] = code;
+  encoded[nbEncoded++] = COBS_DELIMITER;
+
+  return nbEncoded;
+}
+
+void COBS_DecoderInit(TCOBSDecoder * const decoder, uint8_t buffer[], const uint16_t size)
+{
+  decoder->Buffer = buffer;
+  decoder->Size = size;
+  decoder->NbBytes = 0;
+  decoder->Code = COBS_MAX_CODE;
+  decoder->NbRemaining = 0;
+  decoder->Discarding = false;
+}
+
+uint16_t COBS_Decode(TCOBSDecoder * const decoder, const uint8_t data)
+{
+  if (data == COBS_DELIMITER)
+  {
+    // A complete frame ends on a block boundary, the zero implied by its last block being the delimiter itself
+    const uint16_t nbBytes = (decoder->Discarding || decoder->NbRemaining != 0) ? 0 : decoder->NbBytes;
+
+    decoder->NbBytes = 0;
+    decoder->Code = COBS_MAX_CODE;
+    decoder->NbRemaining = 0;
+    decoder->Discarding = false;
+    return nbBytes;
+  }
+
+  if (decoder->Discarding)
+    return 0;
+
+  if (decoder->NbRemaining == 0)
+  {
+    // A code byte, so the previous block (if any) stood for a zero, unless it was a full block
+    if (decoder->NbBytes + (decoder->Code != COBS_MAX_CODE) + data - 1 > decoder->Size)
+    {
+      decoder->Discarding = true;
+      return 0;
+    }
+
+    if (decoder->Code != COBS_MAX_CODE)
+      decoder->Buffer[decoder->NbBytes++] = 0;
+
+    decoder->Code = data;
+    decoder->NbRemaining = data - 1;
+  }
+  else
+  {
+    decoder->Buffer[decoder->NbBytes++] = data;
+    decoder->NbRemaining--;
+  }
+
+  return 0;
+}
+
+/*!
+ * @}
+ */
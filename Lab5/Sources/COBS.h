@@ -0,0 +1,71 @@
+/*! @file
+ *
+ *  @brief Consistent Overhead Byte Stuffing (COBS) framing.
+ *
+ *  This contains the functions for encoding frames with COBS, so that 0x00 only ever appears as the delimiter
+ *  between frames, and for decoding them again a byte at a time.
+ *  Neither allocates memory or touches the hardware, so both may be used from an ISR, or built on the PC.
+ *
+ *  @author Group 13, Jacob Dunk (11654718) & Brenton Smith (11380654)
+ *  @date 2016-11-07
+ */
+
+#ifndef COBS_H
+#define COBS_H
+
+// new types
+#include "types.h"
+
+// The byte that ends every encoded frame
+#define COBS_DELIMITER 0x00
+
+// Largest size of an encoded frame of nbBytes, including its delimiter
+#define COBS_MAX_ENCODED_SIZE(nbBytes) ((nbBytes) + ((nbBytes) / 254) + 2)
+
+/*!
+ * @struct TCOBSDecoder
+ *
+ * The state of a frame being decoded, owned by the caller.
+ */
+typedef struct
+{
+  uint8_t * Buffer;       /*!< The storage for the decoded frame */
+  uint16_t Size;          /*!< The capacity of Buffer in bytes */
+  uint16_t NbBytes;       /*!< The number of bytes decoded so far */
+  uint8_t Code;           /*!< The code byte of the current block */
+  uint8_t NbRemaining;    /*!< The number of data bytes left in the current block, 0 when the next byte is a code byte */
+  bool Discarding;        /*!< TRUE after an error, until the next delimiter */
+} TCOBSDecoder;
+
+/*! @brief Encode a frame, followed by its delimiter.
+ *
+ *  @param data The bytes of the frame.
+ *  @param nbBytes The number of bytes in the frame.
+ *  @param encoded Storage for COBS_MAX_ENCODED_SIZE(nbBytes) bytes. Must not overlap data.
+ *  @return uint16_t - The number of bytes written to encoded, including the delimiter.
+ */
+uint16_t COBS_Encode(const uint8_t data[], const uint16_t nbBytes, uint8_t encoded[]);
+
+/*! @brief Prepare a decoder to decode frames into a buffer.
+ *
+ *  The decoder assumes it starts at the beginning of a frame. If it actually starts part way through one,
+ *  that partial frame is returned, so the caller must check the frames it is given.
+ *
+ *  @param decoder A pointer to the decoder.
+ *  @param buffer The storage for a decoded frame.
+ *  @param size The capacity of buffer in bytes, frames longer than this are discarded.
+ */
+void COBS_DecoderInit(TCOBSDecoder* const decoder, uint8_t buffer[], const uint16_t size);
+
+/*! @brief Decode the next received byte.
+ *
+ *  A corrupted or oversized frame is discarded, and decoding starts afresh after the next delimiter.
+ *
+ *  @param decoder A pointer to the decoder.
+ *  @param data The received byte.
+ *  @return uint16_t - The length of the frame now in the decoder's buffer once data is the delimiter ending a valid frame,
+ *                     otherwise 0. The frame remains valid until the next call.
+ */
+uint16_t COBS_Decode(TCOBSDecoder* const decoder, const uint8_t data);
+
+#endif
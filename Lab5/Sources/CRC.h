@@ -0,0 +1,83 @@
+/*! @file
+ *
+ *  @brief Routines for calculating CRCs with the Cyclic Redundancy Check (CRC) module on the TWR-K70F120M.
+ *
+ *  This contains the functions for calculating CRC-16 and CRC-32 checks, in hardware or by table lookup.
+ *
+ *  @author Group 13, Jacob Dunk (11654718) & Brenton Smith (11380654)
+ *  @date 2016-11-07
+ */
+
+#ifndef CRC_H
+#define CRC_H
+
+// new types
+#include "types.h"
+
+/*!
+ * @struct TCRCBenchmark
+ *
+ * The CPU cycles taken to check one buffer by each way of calculating a CRC.
+ */
+typedef struct
+{
+  uint32_t NbBytes;               /*!< The size of the buffer checked */
+  uint32_t Calculate16Cycles;     /*!< Cycles taken by CRC_Calculate16 */
+  uint32_t Software16Cycles;      /*!< Cycles taken by CRC_Software16 */
+  uint32_t Calculate32Cycles;     /*!< Cycles taken by CRC_Calculate32 */
+  uint32_t Software32Cycles;      /*!< Cycles taken by CRC_Software32 */
+} TCRCBenchmark;
+
+/*! @brief Sets up the CRC module before first use.
+ *
+ *  @return bool - TRUE if the CRC module was successfully initialized.
+ */
+bool CRC_Init(void);
+
+/*! @brief Calculates the CRC-16/CCITT-FALSE of a buffer (polynomial 0x1021, seed 0xFFFF, not reflected).
+ *
+ *  Uses the CRC module, unless it has been compiled out, and may be called by several threads at once.
+ *  @param data The bytes to check.
+ *  @param nbBytes The number of bytes.
+ *  @return uint16_t - The CRC, 0x29B1 for the ASCII string "123456789".
+ *  @note Assumes that CRC_Init has been called.
+ */
+uint16_t CRC_Calculate16(const uint8_t data[], const uint32_t nbBytes);
+
+/*! @brief Calculates the CRC-32 of a buffer, as used by Ethernet and zip (polynomial 0x04C11DB7, seed and final XOR 0xFFFFFFFF, reflected).
+ *
+ *  Uses the CRC module, unless it has been compiled out, and may be called by several threads at once.
+ *  @param data The bytes to check.
+ *  @param nbBytes The number of bytes.
+ *  @return uint32_t - The CRC, 0xCBF43926 for the ASCII string "123456789".
+ *  @note Assumes that CRC_Init has been called.
+ */
+uint32_t CRC_Calculate32(const uint8_t data[], const uint32_t nbBytes);
+
+/*! @brief Calculates the same CRC-16 as CRC_Calculate16 by table lookup, without the CRC module.
+ *
+ *  @param data The bytes to check.
+ *  @param nbBytes The number of bytes.
+ *  @return uint16_t - The CRC.
+ */
+uint16_t CRC_Software16(const uint8_t data[], const uint32_t nbBytes);
+
+/*! @brief Calculates the same CRC-32 as CRC_Calculate32 by table lookup, without the CRC module.
+ *
+ *  @param data The bytes to check.
+ *  @param nbBytes The number of bytes.
+ *  @return uint32_t - The CRC.
+ */
+uint32_t CRC_Software32(const uint8_t data[], const uint32_t nbBytes);
+
+/*! @brief Times each way of calculating a CRC over one buffer with the DWT cycle counter.
+ *
+ *  @param data The bytes to check.
+ *  @param nbBytes The number of bytes.
+ *  @param resultsPtr A pointer to store the cycle counts.
+ *  @return bool - TRUE if the hardware and software CRCs agreed.
+ *  @note Assumes that CRC_Init has been called.
+ */
+bool CRC_Benchmark(const uint8_t data[], const uint32_t nbBytes, TCRCBenchmark* const resultsPtr);
+
+#endif
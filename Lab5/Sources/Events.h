@@ -39,6 +39,7 @@
 #include "INT_FTM0.h"
 #include "INT_PendableSrvReq.h"
 #include "INT_SysTick.h"
+#include "INT_DMA1_DMA17.h"
 
 #ifdef __cplusplus
 extern "C" {
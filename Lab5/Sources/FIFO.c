@@ -1,8 +1,9 @@
 /*! @file
  *
- *  @brief Byte Wide FIFO Circular Buffer
+ *  @brief FIFO Circular Buffers
  *
- *  This contains the implementation for an array backed byte-wide FIFO Circular Buffer.
+ *  This contains the element independent implementation of the array backed FIFO Circular Buffers
+ *  declared with FIFO_DEFINE, and the multiple producer slot FIFO.
  *
  *  Created in Kinetis Design Studio 3.2.0 for the TWR-K70F120M (MK70FN1M0VMJ12 microcontroller)
  *
@@ -17,87 +18,427 @@
 
 #include "FIFO.h"
 #include "Cpu.h"
+#include <stddef.h>
 
-void FIFO_Init(TFIFO * const FIFO)
+/*! @brief Wake a thread blocked on the FIFO if enough elements are now available to it
+ *
+ *  @param waitingPtr A pointer to the number of elements the blocked thread needs, 0 if none are blocked.
+ *  @param available The number of elements now available to the blocked thread.
+ *  @param semaphore The semaphore the blocked thread is waiting on.
+ */
+static void WakeIfReady(uint16_t volatile * const waitingPtr, const uint16_t available, OS_ECB * const semaphore)
 {
-  FIFO->NbBytes = 0; // Queue is empty when NbBytes == 0 and full when NbBytes == FIFO_SIZE
+  const uint16_t waiting = *waitingPtr;
 
+  if (waiting != 0 && available >= waiting)
+  {
+    // Clear before signalling so each registration is matched by at most one signal
+    *waitingPtr = 0;
+    OS_SemaphoreSignal(semaphore);
+  }
+}
+
+void FIFO_StateInit(TFIFOState * const state)
+{
   // When the buffer is empty, start index = end index = 0 (front of the buffer)
-  FIFO->Start = 0;
-  FIFO->End = 0;
-  FIFO->GetSemaphore = OS_SemaphoreCreate(0);
-  FIFO->PutSemaphore = OS_SemaphoreCreate(FIFO_SIZE);
+  // Queue is empty when Start == End and full when (End - Start) == Size
+  state->Start = 0;
+  state->End = 0;
+  state->GetWaiting = 0;
+  state->PutWaiting = 0;
+  state->GetThreshold = 1;
+  state->GetSemaphore = OS_SemaphoreCreate(0);
+  state->PutSemaphore = OS_SemaphoreCreate(0);
+
+#ifdef FIFO_ENABLE_STATISTICS
+  memset(&state->Statistics, 0, sizeof(state->Statistics));
+#endif
 }
 
-bool FIFO_Put(TFIFO * const FIFO, const uint8_t data)
+void FIFO_Publish(TFIFOState * const state, const uint16_t end)
 {
-  bool result = false;
+#ifdef FIFO_ENABLE_STATISTICS
+  const uint16_t nbElements = end - state->Start;
 
-  // Start critical region to ensure integrity of Buffer
-  EnterCritical();
+  state->Statistics.NbPut += (uint16_t)(end - state->End);
+  if (nbElements > state->Statistics.PeakNbElements)
+    state->Statistics.PeakNbElements = nbElements;
+#endif
+
+  // Ensure the data is written before the consumer can see the new End index,
+  // and End is written before checking whether the consumer is waiting
+  FIFO_MEMORY_BARRIER();
+  state->End = end;
+  FIFO_MEMORY_BARRIER();
+
+  WakeIfReady(&state->GetWaiting, (uint16_t)(end - state->Start), state->GetSemaphore);
+}
 
-  // Check if buffer full
-  if (FIFO->NbBytes < FIFO_SIZE) // FIFO full error: Not able to Put anymore data.
+void FIFO_Release(TFIFOState * const state, const uint16_t start, const uint16_t size)
+{
+#ifdef FIFO_ENABLE_STATISTICS
+  state->Statistics.NbGet += (uint16_t)(start - state->Start);
+#endif
+
+  // Ensure the data is read before the producer can reuse its position,
+  // and Start is written before checking whether the producer is waiting
+  FIFO_MEMORY_BARRIER();
+  state->Start = start;
+  FIFO_MEMORY_BARRIER();
+
+  WakeIfReady(&state->PutWaiting, size - (uint16_t)(state->End - start), state->PutSemaphore);
+}
+
+void FIFO_StateFlush(TFIFOState * const state)
+{
+  // Any elements at all are enough for the blocked consumer
+  if (state->End != state->Start)
+    WakeIfReady(&state->GetWaiting, UINT16_MAX, state->GetSemaphore);
+}
+
+/*! @brief Wait on a FIFO semaphore for what is left of a timeout, with debug halt on failure
+ *
+ *  @param semaphore The semaphore to wait on.
+ *  @param startTicks The OS time when the operation started waiting.
+ *  @param timeout The number of ticks the whole operation may wait, 0 to wait forever.
+ *  @param blockedTicksPtr A pointer to the total ticks spent blocked, to be updated.
+ *  @return bool - TRUE if the semaphore was signalled before the timeout expired.
+ */
+static bool Wait(OS_ECB * const semaphore, const uint32_t startTicks, const uint32_t timeout, uint32_t * const blockedTicksPtr)
+{
+  uint32_t remaining = 0;
+  OS_ERROR error;
+
+  // Earlier wake-ups have already used part of the timeout
+  if (timeout != 0)
   {
-    // Append data to the buffer
-    FIFO->Buffer[FIFO->End] = data;
-    FIFO->NbBytes++; // Maintain number of bytes in the buffer
+    const uint32_t elapsed = OS_TimeGet() - startTicks;
 
-    // Increment End index, wrapping to the front if necessary
-    FIFO->End = (FIFO->End + 1) % FIFO_SIZE;
+    if (elapsed >= timeout)
+      return false;
 
-    OS_SemaphoreSignal(FIFO->GetSemaphore);
-    result = true;
+    remaining = timeout - elapsed;
   }
 
-  ExitCritical();
+#ifdef FIFO_ENABLE_STATISTICS
+  const uint32_t waitTicks = OS_TimeGet();
+#endif
+
+  error = OS_SemaphoreWait(semaphore, remaining);
+
+#ifdef FIFO_ENABLE_STATISTICS
+  *blockedTicksPtr += OS_TimeGet() - waitTicks;
+#endif
+
+  // A timeout is expected, anything else is a programming error
+  if (error != OS_NO_ERROR && error != OS_TIMEOUT)
+    PE_DEBUGHALT();
 
-  return result;
+  return error == OS_NO_ERROR;
 }
 
-bool FIFO_Get(TFIFO * const FIFO, uint8_t * const dataPtr)
+bool FIFO_WaitToPut(TFIFOState * const state, const uint32_t startTicks, const uint32_t timeout)
 {
-  bool result = false;
+#ifdef FIFO_ENABLE_STATISTICS
+  return Wait(state->PutSemaphore, startTicks, timeout, &state->Statistics.PutBlockedTicks);
+#else
+  return Wait(state->PutSemaphore, startTicks, timeout, NULL);
+#endif
+}
 
-  // Start critical region to ensure integrity of Buffer
-  EnterCritical();
+bool FIFO_WaitToGet(TFIFOState * const state, const uint32_t startTicks, const uint32_t timeout)
+{
+#ifdef FIFO_ENABLE_STATISTICS
+  return Wait(state->GetSemaphore, startTicks, timeout, &state->Statistics.GetBlockedTicks);
+#else
+  return Wait(state->GetSemaphore, startTicks, timeout, NULL);
+#endif
+}
+
+bool FIFO_StateGetStatistics(const TFIFOState * const state, TFIFOStatistics * const statisticsPtr)
+{
+#ifdef FIFO_ENABLE_STATISTICS
+  *statisticsPtr = state->Statistics;
+  statisticsPtr->NbElements = state->End - state->Start;
+  return true;
+#else
+  memset(statisticsPtr, 0, sizeof(*statisticsPtr));
+  return false;
+#endif
+}
+
+/*! @brief Atomically replace a value if it has not been changed by another context.
+ *
+ *  @param addressPtr A pointer to the value.
+ *  @param expected The value last read.
+ *  @param desired The value to store.
+ *  @return bool - TRUE if the value was still expected and has been replaced.
+ */
+static bool CompareAndSwap(uint16_t volatile * const addressPtr, const uint16_t expected, const uint16_t desired)
+{
+#ifdef __arm__
+  uint32_t value, failed;
 
-  // Check if buffer is empty
-  if (FIFO->NbBytes > 0) // FIFO empty error: Nothing to Get.
+  // The exclusive monitor is cleared by any exception, so a preempting thread or ISR makes the store fail
+  __asm volatile ("ldrexh %0, [%1]" : "=r" (value) : "r" (addressPtr) : "memory");
+  if (value != expected)
   {
-    // Get data from the buffer
-    *dataPtr = FIFO->Buffer[FIFO->Start];
-    FIFO->NbBytes--; // Maintain number of bytes in the buffer
+    __asm volatile ("clrex" ::: "memory");
+    return false;
+  }
 
-    // Increment Start index, wrapping to the front if necessary
-    FIFO->Start = (FIFO->Start + 1) % FIFO_SIZE;
+  __asm volatile ("strexh %0, %2, [%1]" : "=&r" (failed) : "r" (addressPtr), "r" ((uint32_t)desired) : "memory");
+  return failed == 0;
+#else
+  return __sync_bool_compare_and_swap(addressPtr, expected, desired);
+#endif
+}
 
-    OS_SemaphoreSignal(FIFO->PutSemaphore);
+/*! @brief Atomically add to a value shared between contexts.
+ *
+ *  @param addressPtr A pointer to the value.
+ *  @param amount The amount to add.
+ */
+static void AtomicAdd(uint16_t volatile * const addressPtr, const int16_t amount)
+{
+  uint16_t value;
+
+  do
+  {
+    value = *addressPtr;
+  } while (!CompareAndSwap(addressPtr, value, value + amount));
+}
+
+/*! @brief Claim the next free slot for the calling producer.
+ *
+ *  @param FIFO A pointer to the slot FIFO.
+ *  @return TFIFOSlot* - The claimed slot, or NULL if the FIFO is full.
+ */
+static TFIFOSlot * ClaimSlot(TSlotFIFO * const FIFO)
+{
+  uint16_t claimed;
+
+  do
+  {
+    claimed = FIFO->Claimed;
+
+    if ((uint16_t)(claimed - FIFO->Start) >= FIFO->NbSlots)
+      return NULL;
+  } while (!CompareAndSwap(&FIFO->Claimed, claimed, claimed + 1));
+
+  // Ensure the consumer has finished with the slot before it is written
+  FIFO_MEMORY_BARRIER();
+  return &FIFO->Slots[claimed & (FIFO->NbSlots - 1)];
+}
+
+/*! @brief Discard the oldest message, if the consumer has not started sending it.
+ *
+ *  @param FIFO A pointer to the slot FIFO.
+ *  @return bool - TRUE if a slot was freed.
+ */
+static bool DropOldestSlot(TSlotFIFO * const FIFO)
+{
+  bool dropped = false;
+
+  // The consumer (and other producers) must not run while a producer acts as the consumer
+  EnterCritical();
 
-    result = true;
+  TFIFOSlot * const slot = &FIFO->Slots[FIFO->Start & (FIFO->NbSlots - 1)];
+
+  if (FIFO->Offset == 0 && slot->Ready)
+  {
+    slot->Ready = 0;
+    FIFO_MEMORY_BARRIER();
+    FIFO->Start++;
+    dropped = true;
+
+#ifdef FIFO_ENABLE_STATISTICS
+    FIFO->Statistics.NbDropped++;
+#endif
   }
 
   ExitCritical();
+  return dropped;
+}
 
-  return result;
+void FIFO_SlotInit(TSlotFIFO * const FIFO, TFIFOSlot slots[], const uint16_t nbSlots)
+{
+  FIFO->Claimed = 0;
+  FIFO->Start = 0;
+  FIFO->NbPutWaiting = 0;
+  FIFO->NbSlots = nbSlots;
+  FIFO->Offset = 0;
+  FIFO->DropOldest = false;
+  FIFO->Slots = slots;
+  FIFO->PutSemaphore = OS_SemaphoreCreate(0);
+
+  // No slot has been committed
+  memset(slots, 0, nbSlots * sizeof(TFIFOSlot));
+
+#ifdef FIFO_ENABLE_STATISTICS
+  memset(&FIFO->Statistics, 0, sizeof(FIFO->Statistics));
+#endif
 }
 
-void FIFO_BlockingGet(TFIFO * const FIFO, uint8_t * dataPtr)
+uint8_t * FIFO_SlotReserve(TSlotFIFO * const FIFO, const uint32_t timeout)
 {
-  if (OS_SemaphoreWait(FIFO->GetSemaphore, 0) != OS_NO_ERROR)
-    PE_DEBUGHALT();
+  TFIFOSlot * slot = ClaimSlot(FIFO);
 
-  if (!FIFO_Get(FIFO, dataPtr))
-    PE_DEBUGHALT();
+  // Make room by discarding the oldest message, rather than waiting for it to be sent
+  while (!slot && FIFO->DropOldest && DropOldestSlot(FIFO))
+    slot = ClaimSlot(FIFO);
+
+  if (slot)
+    return slot->Bytes;
+
+  // The FIFO is full (and the oldest message is already being sent), so wait for the consumer to free a slot.
+  // Registering before retrying ensures a slot freed in between is never missed.
+  const uint32_t startTicks = OS_TimeGet();
+
+  AtomicAdd(&FIFO->NbPutWaiting, 1);
+
+  for (;;)
+  {
+    slot = ClaimSlot(FIFO);
+#ifdef FIFO_ENABLE_STATISTICS
+    if (slot || !Wait(FIFO->PutSemaphore, startTicks, timeout, &FIFO->Statistics.PutBlockedTicks))
+#else
+    if (slot || !Wait(FIFO->PutSemaphore, startTicks, timeout, NULL))
+#endif
+      break;
+  }
+
+  AtomicAdd(&FIFO->NbPutWaiting, -1);
+
+  if (!slot)
+  {
+#ifdef FIFO_ENABLE_STATISTICS
+    FIFO->Statistics.NbDropped++;
+#endif
+    return NULL;
+  }
+
+  return slot->Bytes;
 }
 
-void FIFO_BlockingPut(TFIFO * const FIFO, uint8_t data)
+void FIFO_SlotSetDropOldest(TSlotFIFO * const FIFO, const bool dropOldest)
 {
-  if (OS_SemaphoreWait(FIFO->PutSemaphore, 0) != OS_NO_ERROR)
-    PE_DEBUGHALT();
+  FIFO->DropOldest = dropOldest;
+}
 
-  if (!FIFO_Put(FIFO, data))
-    PE_DEBUGHALT();
+void FIFO_SlotCommit(TSlotFIFO * const FIFO, uint8_t * const dataPtr, const uint8_t nbBytes)
+{
+  TFIFOSlot * const slot = (TFIFOSlot *)(dataPtr - offsetof(TFIFOSlot, Bytes));
+
+  slot->NbBytes = nbBytes;
+
+#ifdef FIFO_ENABLE_STATISTICS
+  const uint16_t nbSlots = FIFO->Claimed - FIFO->Start;
+
+  FIFO->Statistics.NbPut++;
+  if (nbSlots > FIFO->Statistics.PeakNbElements)
+    FIFO->Statistics.PeakNbElements = nbSlots;
+#endif
+
+  // Ensure the message is written before the consumer can see the slot is ready
+  FIFO_MEMORY_BARRIER();
+  slot->Ready = 1;
+}
+
+/*! @brief Find the oldest message, if it has been committed.
+ *
+ *  @param FIFO A pointer to the slot FIFO.
+ *  @return TFIFOSlot* - The oldest slot, or NULL if it is still being built (or the FIFO is empty).
+ */
+static TFIFOSlot * OldestSlot(TSlotFIFO * const FIFO)
+{
+  TFIFOSlot * const slot = &FIFO->Slots[FIFO->Start & (FIFO->NbSlots - 1)];
+
+  // Slots are sent in the order they were claimed, so a slot still being built holds up later ones
+  if (!slot->Ready)
+    return NULL;
+
+  // Ensure Ready is read before the message it guards
+  FIFO_MEMORY_BARRIER();
+  return slot;
+}
+
+bool FIFO_SlotGet(TSlotFIFO * const FIFO, uint8_t * const dataPtr)
+{
+  TFIFOSlot * slot;
+
+  while ((slot = OldestSlot(FIFO)))
+  {
+    const bool gotByte = FIFO->Offset < slot->NbBytes;
+
+    if (gotByte)
+      *dataPtr = slot->Bytes[FIFO->Offset++];
+
+    // Once the whole message has been retrieved, return the slot to the producers
+    if (FIFO->Offset >= slot->NbBytes)
+      FIFO_SlotRelease(FIFO);
+
+    // An empty message is skipped
+    if (gotByte)
+      return true;
+  }
+
+  return false;
+}
+
+const uint8_t * FIFO_SlotGetAll(TSlotFIFO * const FIFO, uint8_t * const nbBytesPtr)
+{
+  TFIFOSlot * slot;
+
+  while ((slot = OldestSlot(FIFO)))
+  {
+    if (FIFO->Offset < slot->NbBytes)
+    {
+      const uint8_t * const dataPtr = &slot->Bytes[FIFO->Offset];
+
+      // Mark the whole message as got, so it cannot be dropped while the caller is using it
+      *nbBytesPtr = slot->NbBytes - FIFO->Offset;
+      FIFO->Offset = slot->NbBytes;
+      return dataPtr;
+    }
+
+    // An empty message is skipped
+    FIFO_SlotRelease(FIFO);
+  }
+
+  return NULL;
+}
+
+void FIFO_SlotRelease(TSlotFIFO * const FIFO)
+{
+  TFIFOSlot * const slot = &FIFO->Slots[FIFO->Start & (FIFO->NbSlots - 1)];
+
+  FIFO->Offset = 0;
+  slot->Ready = 0;
+#ifdef FIFO_ENABLE_STATISTICS
+  FIFO->Statistics.NbGet++;
+#endif
+
+  // Ensure the slot is finished with before producers can claim it again,
+  // and Start is written before checking whether a producer is waiting
+  FIFO_MEMORY_BARRIER();
+  FIFO->Start++;
+  FIFO_MEMORY_BARRIER();
+
+  if (FIFO->NbPutWaiting != 0)
+    OS_SemaphoreSignal(FIFO->PutSemaphore);
+}
+
+bool FIFO_SlotGetStatistics(const TSlotFIFO * const FIFO, TFIFOStatistics * const statisticsPtr)
+{
+#ifdef FIFO_ENABLE_STATISTICS
+  *statisticsPtr = FIFO->Statistics;
+  statisticsPtr->NbElements = FIFO->Claimed - FIFO->Start;
+  return true;
+#else
+  memset(statisticsPtr, 0, sizeof(*statisticsPtr));
+  return false;
+#endif
 }
 
 /*!
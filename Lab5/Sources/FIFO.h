@@ -2,7 +2,9 @@
  *
  *  @brief Routines to implement a FIFO buffer.
  *
- *  This contains the structure and "methods" for accessing a byte-wide FIFO.
+ *  This contains the structure and "methods" for accessing a byte-wide FIFO,
+ *  the FIFO_DEFINE macro for declaring FIFOs of other element types and capacities,
+ *  and a multiple producer FIFO of whole messages.
  *
  *  @author PMcL
  *  @date 2015-07-23
@@ -14,65 +16,629 @@
 // new types
 #include "types.h"
 #include "OS.h"
+#include "PE_Types.h"
+#include <string.h>
 
-// Number of bytes in a FIFO
+// Number of bytes in the default byte-wide FIFO, must be a power of two
 #define FIFO_SIZE 256
 
+// Number of bytes that can be accessed in place with FIFO_Peek or FIFO_Reserve
+#define FIFO_WINDOW_SIZE 8
+
+// Commenting the below out disables the FIFO occupancy and throughput statistics
+#define FIFO_ENABLE_STATISTICS
+
+// Data Memory Barrier: all memory accesses before the barrier complete before any after it.
+// On the Cortex-M4 this also stops the compiler from reordering accesses across the barrier.
+#ifdef __arm__
+#define FIFO_MEMORY_BARRIER() __asm volatile ("dmb" ::: "memory")
+#else
+#define FIFO_MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+/*!
+ * @struct TFIFOStatistics
+ *
+ * Each counter is only written by one side of the FIFO, so they are updated without locking.
+ * For a slot FIFO, producers racing each other may occasionally lose an update to the producer counters.
+ */
+typedef struct
+{
+  uint16_t NbElements;      /*!< The number of elements currently stored (filled in when the statistics are read) */
+  uint16_t PeakNbElements;  /*!< The largest number of elements ever stored */
+  uint32_t NbPut;           /*!< The total number of elements put */
+  uint32_t NbGet;           /*!< The total number of elements got */
+  uint32_t NbDropped;       /*!< The total number of elements that could not be put because the FIFO was full */
+  uint32_t PutBlockedTicks; /*!< The total OS ticks producers have spent blocked */
+  uint32_t GetBlockedTicks; /*!< The total OS ticks consumers have spent blocked */
+} TFIFOStatistics;
+
+/*!
+ * @struct TFIFOState
+ *
+ * The element independent state of a lock-free single producer / single consumer FIFO.
+ * Start is only ever written by the consumer and End is only ever written by the producer.
+ * Both indices are free running and are masked with (Size - 1) when accessing the buffer,
+ * so the number of elements stored is always (uint16_t)(End - Start).
+ */
+typedef struct
+{
+  uint16_t volatile Start;      /*!< The free running index of the oldest data in the FIFO (written by the consumer) */
+  uint16_t volatile End;        /*!< The free running index of the next empty position in the FIFO (written by the producer) */
+  uint16_t volatile GetWaiting; /*!< The number of elements a blocked consumer is waiting for, 0 if none */
+  uint16_t volatile PutWaiting; /*!< The number of free elements a blocked producer is waiting for, 0 if none */
+  uint16_t GetThreshold;        /*!< The number of elements a blocked consumer waits to accumulate, unless the FIFO is flushed */
+  OS_ECB * GetSemaphore;        /*!< Signalled once when GetWaiting elements become available */
+  OS_ECB * PutSemaphore;        /*!< Signalled once when PutWaiting elements become free */
+#ifdef FIFO_ENABLE_STATISTICS
+  TFIFOStatistics Statistics;   /*!< The occupancy and throughput counters */
+#endif
+} TFIFOState;
+
+/*! @brief Initialize the element independent state of a FIFO.
+ *
+ *  @param state A pointer to the state to initialize.
+ */
+void FIFO_StateInit(TFIFOState* const state);
+
+/*! @brief Make elements written by the producer visible to the consumer, waking it if it has enough.
+ *
+ *  @param state A pointer to the FIFO state.
+ *  @param end The new End index.
+ */
+void FIFO_Publish(TFIFOState* const state, const uint16_t end);
+
+/*! @brief Return positions read by the consumer to the producer, waking it if it has enough room.
+ *
+ *  @param state A pointer to the FIFO state.
+ *  @param start The new Start index.
+ *  @param size The capacity of the FIFO.
+ */
+void FIFO_Release(TFIFOState* const state, const uint16_t start, const uint16_t size);
+
+/*! @brief Block the calling producer thread until it is signalled that PutWaiting elements are free.
+ *
+ *  @param state A pointer to the FIFO state.
+ *  @param startTicks The OS time when the operation started waiting.
+ *  @param timeout The number of ticks the whole operation may wait, 0 to wait forever.
+ *  @return bool - TRUE if signalled, FALSE if the timeout expired.
+ */
+bool FIFO_WaitToPut(TFIFOState* const state, const uint32_t startTicks, const uint32_t timeout);
+
+/*! @brief Block the calling consumer thread until it is signalled that GetWaiting elements are available.
+ *
+ *  @param state A pointer to the FIFO state.
+ *  @param startTicks The OS time when the operation started waiting.
+ *  @param timeout The number of ticks the whole operation may wait, 0 to wait forever.
+ *  @return bool - TRUE if signalled, FALSE if the timeout expired.
+ */
+bool FIFO_WaitToGet(TFIFOState* const state, const uint32_t startTicks, const uint32_t timeout);
+
+/*! @brief Wake a blocked consumer if any elements are available, even if fewer than it is waiting for.
+ *
+ *  @param state A pointer to the FIFO state.
+ *  @note May be called from an ISR, e.g. when the producer has gone idle.
+ */
+void FIFO_StateFlush(TFIFOState* const state);
+
+/*! @brief Take a snapshot of the FIFO statistics.
+ *
+ *  @param state A pointer to the FIFO state.
+ *  @param statisticsPtr A pointer to store the statistics.
+ *  @return bool - TRUE if statistics are enabled (FIFO_ENABLE_STATISTICS).
+ */
+bool FIFO_StateGetStatistics(const TFIFOState* const state, TFIFOStatistics* const statisticsPtr);
+
+/*! @brief The number of elements a consumer that needs nbElements registers to be woken for.
+ *
+ *  @param state A pointer to the FIFO state.
+ *  @param nbElements The number of elements the consumer needs.
+ *  @param size The capacity of the FIFO.
+ *  @return uint16_t - The larger of nbElements and the wake threshold, no greater than size.
+ */
+static inline uint16_t FIFO_GetWaitCount(const TFIFOState* const state, const uint16_t nbElements, const uint16_t size)
+{
+  const uint16_t waitCount = (nbElements > state->GetThreshold) ? nbElements : state->GetThreshold;
+  return (waitCount < size) ? waitCount : size;
+}
+
+/*! @brief Record elements that could not be put because the FIFO was full.
+ *
+ *  @param state A pointer to the FIFO state.
+ *  @param nbElements The number of elements dropped.
+ */
+static inline void FIFO_Dropped(TFIFOState* const state, const uint16_t nbElements)
+{
+#ifdef FIFO_ENABLE_STATISTICS
+  state->Statistics.NbDropped += nbElements;
+#endif
+}
+
+/*! @brief Record how many elements a thread is about to block for.
+ *
+ *  Registration happens before checking the FIFO, so a transfer from the other side can never be missed.
+ *
+ *  @param waitingPtr A pointer to GetWaiting or PutWaiting.
+ *  @param nbElements The number of elements needed, 0 when no longer waiting.
+ */
+static inline void FIFO_Register(uint16_t volatile * const waitingPtr, const uint16_t nbElements)
+{
+  *waitingPtr = nbElements;
+  FIFO_MEMORY_BARRIER();
+}
+
+/*! @brief Declares a FIFO type and its operations for an element type and capacity.
+ *
+ *  Generates the type T<Name> and the functions <Name>_Init, <Name>_Put, <Name>_Get, <Name>_PutN,
+ *  <Name>_GetN, <Name>_Peek, <Name>_Consume, <Name>_Reserve, <Name>_Commit, their Timed variants that
+ *  wait up to a timeout, their Blocking variants that wait forever, <Name>_NbElements, <Name>_SetWakeThreshold,
+ *  <Name>_Flush and <Name>_GetStatistics.
+ *  The capacity and element type are compile time constants in every generated function.
+ *
+ *  The first WindowSize elements of the buffer are mirrored after Size, so a window of up to
+ *  WindowSize elements can be accessed in place with Peek or Reserve even when it wraps.
+ *
+ *  The non-blocking functions may be called from an ISR. The Timed and Blocking functions may only be called from threads.
+ *  Only one context (thread or ISR) may put into, and one context get from, a given FIFO at a time.
+ *
+ *  @param Name The prefix for the generated type and functions.
+ *  @param Type The element type.
+ *  @param Size The capacity in elements, a power of two no greater than 32768 and at least 2 * WindowSize.
+ *  @param WindowSize The largest number of elements that can be accessed in place.
+ */
+#define FIFO_DEFINE(Name, Type, Size, WindowSize) \
+\
+typedef char Name##_SizeIsValid[(((Size) & ((Size) - 1)) == 0 && (Size) <= 32768 && (Size) >= 2 * (WindowSize)) ? 1 : -1]; \
+\
+typedef struct \
+{ \
+  TFIFOState State;                     /*!< The indices and semaphores */ \
+  Type Buffer[(Size) + (WindowSize)];   /*!< The elements, plus the window copy */ \
+} T##Name; \
+\
+/* Duplicate elements newly written at the front of the buffer into the window copy */ \
+static inline void Name##_SyncWindow(T##Name * const FIFO, const uint16_t offset, const uint16_t nbElements) \
+{ \
+  /* Held in a variable so a FIFO without a window does not compare an index against a constant 0 */ \
+  const uint16_t windowSize = (WindowSize); \
+\
+  if (offset < windowSize) \
+    memcpy(&FIFO->Buffer[(Size) + offset], &FIFO->Buffer[offset], \
+        ((nbElements < windowSize - offset) ? nbElements : windowSize - offset) * sizeof(Type)); \
+} \
+\
+static inline void Name##_Init(T##Name * const FIFO) \
+{ \
+  FIFO_StateInit(&FIFO->State); \
+} \
+\
+static inline bool Name##_TryPutN(T##Name * const FIFO, const Type * const dataPtr, const uint16_t nbElements) \
+{ \
+  const uint16_t end = FIFO->State.End; \
+\
+  /* Check there is room for all of the data */ \
+  if ((uint16_t)(end - FIFO->State.Start) > (Size) - nbElements) \
+    return false; \
+\
+  /* Copy in at most two segments: up to the end of the buffer, then from the front */ \
+  const uint16_t offset = end & ((Size) - 1); \
+  const uint16_t firstNbElements = (nbElements < (Size) - offset) ? nbElements : (Size) - offset; \
+\
+  memcpy(&FIFO->Buffer[offset], dataPtr, firstNbElements * sizeof(Type)); \
+  memcpy(&FIFO->Buffer[0], dataPtr + firstNbElements, (nbElements - firstNbElements) * sizeof(Type)); \
+\
+  Name##_SyncWindow(FIFO, offset, firstNbElements); \
+  Name##_SyncWindow(FIFO, 0, nbElements - firstNbElements); \
+\
+  FIFO_Publish(&FIFO->State, end + nbElements); \
+  return true; \
+} \
+\
+/* Put, recording the elements as dropped if there is no room */ \
+static inline bool Name##_PutN(T##Name * const FIFO, const Type * const dataPtr, const uint16_t nbElements) \
+{ \
+  if (Name##_TryPutN(FIFO, dataPtr, nbElements)) \
+    return true; \
+\
+  FIFO_Dropped(&FIFO->State, nbElements); \
+  return false; \
+} \
+\
+static inline bool Name##_GetN(T##Name * const FIFO, Type * const dataPtr, const uint16_t nbElements) \
+{ \
+  const uint16_t start = FIFO->State.Start; \
+\
+  /* Check all of the data is available */ \
+  if ((uint16_t)(FIFO->State.End - start) < nbElements) \
+    return false; \
+\
+  /* Ensure the End index is read before the data it guards */ \
+  FIFO_MEMORY_BARRIER(); \
+\
+  /* Copy out in at most two segments: up to the end of the buffer, then from the front */ \
+  const uint16_t offset = start & ((Size) - 1); \
+  const uint16_t firstNbElements = (nbElements < (Size) - offset) ? nbElements : (Size) - offset; \
+\
+  memcpy(dataPtr, &FIFO->Buffer[offset], firstNbElements * sizeof(Type)); \
+  memcpy(dataPtr + firstNbElements, &FIFO->Buffer[0], (nbElements - firstNbElements) * sizeof(Type)); \
+\
+  FIFO_Release(&FIFO->State, start + nbElements, (Size)); \
+  return true; \
+} \
+\
+static inline bool Name##_Put(T##Name * const FIFO, const Type data) \
+{ \
+  return Name##_PutN(FIFO, &data, 1); \
+} \
+\
+static inline bool Name##_Get(T##Name * const FIFO, Type * const dataPtr) \
+{ \
+  return Name##_GetN(FIFO, dataPtr, 1); \
+} \
+\
+static inline const Type * Name##_Peek(T##Name * const FIFO, const uint16_t nbElements) \
+{ \
+  const uint16_t start = FIFO->State.Start; \
+\
+  /* Check the window fits and all of the data is available */ \
+  if (nbElements > (WindowSize) || (uint16_t)(FIFO->State.End - start) < nbElements) \
+    return NULL; \
+\
+  /* Ensure the End index is read before the data it guards */ \
+  FIFO_MEMORY_BARRIER(); \
+\
+  /* The window copy keeps the elements contiguous across the wrap point */ \
+  return &FIFO->Buffer[start & ((Size) - 1)]; \
+} \
+\
+static inline void Name##_Consume(T##Name * const FIFO, const uint16_t nbElements) \
+{ \
+  FIFO_Release(&FIFO->State, FIFO->State.Start + nbElements, (Size)); \
+} \
+\
+/* The number of elements stored, which may grow (for the consumer) or shrink (for the producer) at any time */ \
+static inline uint16_t Name##_NbElements(const T##Name * const FIFO) \
+{ \
+  return (uint16_t)(FIFO->State.End - FIFO->State.Start); \
+} \
+\
+static inline Type * Name##_Reserve(T##Name * const FIFO, const uint16_t nbElements) \
+{ \
+  const uint16_t end = FIFO->State.End; \
+\
+  /* Check the window fits and there is room for all of the data */ \
+  if (nbElements > (WindowSize) || (uint16_t)(end - FIFO->State.Start) > (Size) - nbElements) \
+    return NULL; \
+\
+  /* Writes past the end of the buffer land in the window copy, and are moved to the front on Commit */ \
+  return &FIFO->Buffer[end & ((Size) - 1)]; \
+} \
+\
+static inline void Name##_Commit(T##Name * const FIFO, const uint16_t nbElements) \
+{ \
+  const uint16_t end = FIFO->State.End; \
+  const uint16_t offset = end & ((Size) - 1); \
+\
+  if (offset + nbElements > (Size)) \
+  { \
+    /* Elements written into the window copy belong at the front of the buffer. */ \
+    /* As Size >= 2 * WindowSize, none of the elements before the wrap point are mirrored. */ \
+    memcpy(&FIFO->Buffer[0], &FIFO->Buffer[(Size)], (offset + nbElements - (Size)) * sizeof(Type)); \
+  } \
+  else \
+  { \
+    Name##_SyncWindow(FIFO, offset, nbElements); \
+  } \
+\
+  FIFO_Publish(&FIFO->State, end + nbElements); \
+} \
+\
+/* Wait up to timeout ticks (0 = forever) for room, then put all of the elements, which must fit in the FIFO */ \
+static inline bool Name##_TimedPutN(T##Name * const FIFO, const Type * const dataPtr, const uint16_t nbElements, const uint32_t timeout) \
+{ \
+  const uint32_t startTicks = OS_TimeGet(); \
+\
+  if (nbElements > (Size)) \
+    return false; \
+\
+  for (;;) \
+  { \
+    FIFO_Register(&FIFO->State.PutWaiting, nbElements); \
+    if (Name##_TryPutN(FIFO, dataPtr, nbElements)) \
+      break; \
+    if (!FIFO_WaitToPut(&FIFO->State, startTicks, timeout)) \
+    { \
+      FIFO->State.PutWaiting = 0; \
+      FIFO_Dropped(&FIFO->State, nbElements); \
+      return false; \
+    } \
+  } \
+\
+  FIFO->State.PutWaiting = 0; \
+  return true; \
+} \
+\
+/* Wait up to timeout ticks (0 = forever) for all of the elements, which must fit in the FIFO */ \
+static inline bool Name##_TimedGetN(T##Name * const FIFO, Type * const dataPtr, const uint16_t nbElements, const uint32_t timeout) \
+{ \
+  const uint32_t startTicks = OS_TimeGet(); \
+\
+  if (nbElements > (Size)) \
+    return false; \
+\
+  for (;;) \
+  { \
+    FIFO_Register(&FIFO->State.GetWaiting, FIFO_GetWaitCount(&FIFO->State, nbElements, (Size))); \
+    if (Name##_GetN(FIFO, dataPtr, nbElements)) \
+      break; \
+    if (!FIFO_WaitToGet(&FIFO->State, startTicks, timeout)) \
+    { \
+      FIFO->State.GetWaiting = 0; \
+      return false; \
+    } \
+  } \
+\
+  FIFO->State.GetWaiting = 0; \
+  return true; \
+} \
+\
+static inline bool Name##_TimedPut(T##Name * const FIFO, const Type data, const uint32_t timeout) \
+{ \
+  return Name##_TimedPutN(FIFO, &data, 1, timeout); \
+} \
+\
+static inline bool Name##_TimedGet(T##Name * const FIFO, Type * const dataPtr, const uint32_t timeout) \
+{ \
+  return Name##_TimedGetN(FIFO, dataPtr, 1, timeout); \
+} \
+\
+/* Wait up to timeout ticks (0 = forever) for elements to examine in place, NULL if the timeout expires */ \
+static inline const Type * Name##_TimedPeek(T##Name * const FIFO, const uint16_t nbElements, const uint32_t timeout) \
+{ \
+  const uint32_t startTicks = OS_TimeGet(); \
+  const Type * dataPtr; \
+\
+  /* The window can never hold more than WindowSize elements */ \
+  if (nbElements > (WindowSize)) \
+    PE_DEBUGHALT(); \
+\
+  for (;;) \
+  { \
+    FIFO_Register(&FIFO->State.GetWaiting, FIFO_GetWaitCount(&FIFO->State, nbElements, (Size))); \
+    dataPtr = Name##_Peek(FIFO, nbElements); \
+    if (dataPtr || !FIFO_WaitToGet(&FIFO->State, startTicks, timeout)) \
+      break; \
+  } \
+\
+  FIFO->State.GetWaiting = 0; \
+  return dataPtr; \
+} \
+\
+/* Wait up to timeout ticks (0 = forever) for room to build elements in place, NULL if the timeout expires */ \
+static inline Type * Name##_TimedReserve(T##Name * const FIFO, const uint16_t nbElements, const uint32_t timeout) \
+{ \
+  const uint32_t startTicks = OS_TimeGet(); \
+  Type * dataPtr; \
+\
+  /* The window can never hold more than WindowSize elements */ \
+  if (nbElements > (WindowSize)) \
+    PE_DEBUGHALT(); \
+\
+  for (;;) \
+  { \
+    FIFO_Register(&FIFO->State.PutWaiting, nbElements); \
+    dataPtr = Name##_Reserve(FIFO, nbElements); \
+    if (dataPtr || !FIFO_WaitToPut(&FIFO->State, startTicks, timeout)) \
+      break; \
+  } \
+\
+  FIFO->State.PutWaiting = 0; \
+\
+  /* The elements the caller would have built are lost */ \
+  if (!dataPtr) \
+    FIFO_Dropped(&FIFO->State, nbElements); \
+  return dataPtr; \
+} \
+\
+static inline void Name##_BlockingPutN(T##Name * const FIFO, const Type * dataPtr, uint16_t nbElements) \
+{ \
+  /* Larger spans are moved a whole FIFO at a time */ \
+  while (nbElements > 0) \
+  { \
+    const uint16_t batchNbElements = (nbElements < (Size)) ? nbElements : (Size); \
+\
+    (void) Name##_TimedPutN(FIFO, dataPtr, batchNbElements, 0); \
+    dataPtr += batchNbElements; \
+    nbElements -= batchNbElements; \
+  } \
+} \
+\
+static inline void Name##_BlockingGetN(T##Name * const FIFO, Type * dataPtr, uint16_t nbElements) \
+{ \
+  /* Larger spans are moved a whole FIFO at a time */ \
+  while (nbElements > 0) \
+  { \
+    const uint16_t batchNbElements = (nbElements < (Size)) ? nbElements : (Size); \
+\
+    (void) Name##_TimedGetN(FIFO, dataPtr, batchNbElements, 0); \
+    dataPtr += batchNbElements; \
+    nbElements -= batchNbElements; \
+  } \
+} \
+\
+static inline void Name##_BlockingPut(T##Name * const FIFO, const Type data) \
+{ \
+  Name##_BlockingPutN(FIFO, &data, 1); \
+} \
+\
+static inline void Name##_BlockingGet(T##Name * const FIFO, Type * const dataPtr) \
+{ \
+  Name##_BlockingGetN(FIFO, dataPtr, 1); \
+} \
+\
+static inline const Type * Name##_BlockingPeek(T##Name * const FIFO, const uint16_t nbElements) \
+{ \
+  return Name##_TimedPeek(FIFO, nbElements, 0); \
+} \
+\
+static inline Type * Name##_BlockingReserve(T##Name * const FIFO, const uint16_t nbElements) \
+{ \
+  return Name##_TimedReserve(FIFO, nbElements, 0); \
+} \
+\
+/* Blocked consumers are only woken once nbElements have accumulated (or the FIFO is flushed), */ \
+/* so that a consumer reading a few elements at a time is not woken for every element */ \
+static inline void Name##_SetWakeThreshold(T##Name * const FIFO, const uint16_t nbElements) \
+{ \
+  FIFO->State.GetThreshold = (nbElements == 0) ? 1 : nbElements; \
+} \
+\
+static inline void Name##_Flush(T##Name * const FIFO) \
+{ \
+  FIFO_StateFlush(&FIFO->State); \
+} \
+\
+static inline bool Name##_GetStatistics(const T##Name * const FIFO, TFIFOStatistics * const statisticsPtr) \
+{ \
+  return FIFO_StateGetStatistics(&FIFO->State, statisticsPtr); \
+}
+
 /*!
  * @struct TFIFO
+ *
+ * The default byte-wide FIFO of FIFO_SIZE bytes, with the operations
+ * FIFO_Init, FIFO_Put, FIFO_Get, FIFO_BlockingPut, FIFO_BlockingGet etc.
+ */
+FIFO_DEFINE(FIFO, uint8_t, FIFO_SIZE, FIFO_WINDOW_SIZE)
+
+// Largest number of bytes in one slot of a slot FIFO, enough for an analog frame
+#define FIFO_SLOT_SIZE 32
+
+/*!
+ * @struct TFIFOSlot
+ *
+ * One whole message in a slot FIFO.
  */
 typedef struct
 {
-  uint16_t Start;    /*!< The index of the position of the oldest data in the FIFO */
-  uint16_t End;     /*!< The index of the next available empty position in the FIFO */
-  uint16_t volatile NbBytes;  /*!< The number of bytes currently stored in the FIFO */
-  uint8_t Buffer[FIFO_SIZE];  /*!< The actual array of bytes to store the data */
+  uint8_t volatile Ready;          /*!< Non-zero once the producer has committed the slot, cleared when the consumer has emptied it */
+  uint8_t NbBytes;                 /*!< The number of bytes committed */
+  uint8_t Bytes[FIFO_SLOT_SIZE];   /*!< The message */
+} TFIFOSlot;
 
-  OS_ECB * GetSemaphore;
-  OS_ECB * PutSemaphore;
-} TFIFO;
+/*!
+ * @struct TSlotFIFO
+ *
+ * A multiple producer / single consumer FIFO of whole messages.
+ * Producers claim a slot by atomically advancing Claimed, fill it in place and then mark it ready,
+ * so messages from different producers can never interleave and no lock is needed.
+ * The consumer drains the oldest slot a byte at a time, and only moves on once it is ready.
+ * With DropOldest set, a producer that finds the FIFO full discards the oldest message the
+ * consumer has not started on, so the newest data is always kept.
+ */
+typedef struct
+{
+  uint16_t volatile Claimed;       /*!< The free running index of the next slot to claim (written by producers with exclusive access) */
+  uint16_t volatile Start;         /*!< The free running index of the oldest slot (written by the consumer, or a producer dropping the oldest slot) */
+  uint16_t volatile NbPutWaiting;  /*!< The number of producers blocked waiting for a free slot (written with exclusive access) */
+  uint16_t NbSlots;                /*!< The capacity in slots, a power of two */
+  uint8_t Offset;                  /*!< The index of the next byte to get from the oldest slot (consumer only) */
+  bool DropOldest;                 /*!< TRUE to discard the oldest message not yet started, rather than wait, when full */
+  TFIFOSlot * Slots;               /*!< The slots */
+  OS_ECB * PutSemaphore;           /*!< Signalled when a slot is freed while producers are blocked */
+#ifdef FIFO_ENABLE_STATISTICS
+  TFIFOStatistics Statistics;      /*!< The occupancy and throughput counters, counted in slots */
+#endif
+} TSlotFIFO;
+
+/*! @brief Initialize a slot FIFO.
+ *
+ *  @param FIFO A pointer to the slot FIFO to initialize.
+ *  @param slots The storage for the slots.
+ *  @param nbSlots The number of slots, a power of two no greater than 32768.
+ */
+void FIFO_SlotInit(TSlotFIFO* const FIFO, TFIFOSlot slots[], const uint16_t nbSlots);
+
+/*! @brief Claim a slot to build a message in place. Waits for a free slot if the FIFO is full.
+ *
+ *  May be called by any number of threads at once.
+ *
+ *  @param FIFO A pointer to the slot FIFO.
+ *  @param timeout The maximum number of OS ticks to wait for a free slot, 0 to wait forever.
+ *  @return uint8_t* - A pointer to FIFO_SLOT_SIZE bytes to write, or NULL if the timeout expired.
+ */
+uint8_t* FIFO_SlotReserve(TSlotFIFO* const FIFO, const uint32_t timeout);
 
-/*! @brief Initialize the FIFO before first use.
+/*! @brief Choose whether a full slot FIFO discards its oldest message or makes producers wait.
  *
- *  @param FIFO A pointer to the FIFO that needs initializing.
- *  @return void
+ *  @param FIFO A pointer to the slot FIFO.
+ *  @param dropOldest TRUE to discard the oldest message not yet started, FALSE to wait for a free slot.
+ *  @note Dropping relies on interrupts being disabled to hold off the consumer, so the consumer must be an ISR.
  */
-void FIFO_Init(TFIFO* const FIFO);
+void FIFO_SlotSetDropOldest(TSlotFIFO* const FIFO, const bool dropOldest);
 
-/*! @brief Put one character into the FIFO.
+/*! @brief Hand a slot built after FIFO_SlotReserve to the consumer.
  *
- *  @param FIFO A pointer to a FIFO struct where data is to be stored.
- *  @param data A byte of data to store in the FIFO buffer.
- *  @return bool - TRUE if data is successfully stored in the FIFO.
- *  @note Assumes that FIFO_Init has been called.
+ *  @param FIFO A pointer to the slot FIFO.
+ *  @param dataPtr The pointer returned by FIFO_SlotReserve.
+ *  @param nbBytes The number of bytes written, no greater than FIFO_SLOT_SIZE.
  */
-bool FIFO_Put(TFIFO* const FIFO, const uint8_t data);
+void FIFO_SlotCommit(TSlotFIFO* const FIFO, uint8_t* const dataPtr, const uint8_t nbBytes);
 
-/*! @brief Get one character from the FIFO.
+/*! @brief Get the next byte of the oldest committed message.
  *
- *  @param FIFO A pointer to a FIFO struct with data to be retrieved.
- *  @param dataPtr A pointer to a memory location to place the retrieved byte.
- *  @return bool - TRUE if data is successfully retrieved from the FIFO.
- *  @note Assumes that FIFO_Init has been called.
+ *  @param FIFO A pointer to the slot FIFO.
+ *  @param dataPtr A pointer to store the byte.
+ *  @return bool - TRUE if a byte was retrieved, FALSE if the oldest slot has not been committed yet.
+ *  @note May be called from an ISR. Only one context may get from a given slot FIFO.
  */
-bool FIFO_Get(TFIFO* const FIFO, uint8_t* const dataPtr);
+bool FIFO_SlotGet(TSlotFIFO* const FIFO, uint8_t* const dataPtr);
 
-/*! @brief Get one character from the FIFO, block until one is available
+/*! @brief Get the rest of the oldest committed message in place, e.g. to hand to DMA.
  *
- *  @param FIFO A pointer to a FIFO struct with data to be retrieved.
- *  @param dataPtr A pointer to a memory location to place the retrieved byte.
- *  @note Assumes that FIFO_Init has been called.
+ *  @param FIFO A pointer to the slot FIFO.
+ *  @param nbBytesPtr A pointer to store the number of bytes.
+ *  @return const uint8_t* - A pointer to the bytes, or NULL if the oldest slot has not been committed yet.
+ *  @note The bytes remain valid until they are released with FIFO_SlotRelease.
+ *  @note May be called from an ISR. Only one context may get from a given slot FIFO.
  */
-void FIFO_BlockingGet(TFIFO * const FIFO, uint8_t * dataPtr);
+const uint8_t* FIFO_SlotGetAll(TSlotFIFO* const FIFO, uint8_t* const nbBytesPtr);
 
-/*! @brief Put one character into the FIFO. Blocks until space is available.
+/*! @brief Return the oldest slot to the producers, once the bytes from FIFO_SlotGetAll have been used.
  *
- *  @param FIFO A pointer to a FIFO struct where data is to be stored.
- *  @param data A byte of data to store in the FIFO buffer.
- *  @return bool - TRUE if data is successfully stored in the FIFO.
- *  @note Assumes that FIFO_Init has been called.
+ *  @param FIFO A pointer to the slot FIFO.
+ *  @note May be called from an ISR. Only one context may get from a given slot FIFO.
  */
-void FIFO_BlockingPut(TFIFO* const FIFO, const uint8_t data);
+void FIFO_SlotRelease(TSlotFIFO* const FIFO);
 
+/*! @brief Whether the consumer is part way through a message.
+ *
+ *  @param FIFO A pointer to the slot FIFO.
+ *  @return bool - TRUE if the next byte got continues a message, rather than starting a new one.
+ *  @note Only to be called by the consumer.
+ */
+static inline bool FIFO_SlotIsGetting(const TSlotFIFO* const FIFO)
+{
+  return FIFO->Offset != 0;
+}
+
+/*! @brief The number of slots in use, whether claimed, committed or being got, until the consumer releases them.
+ *
+ *  @param FIFO A pointer to the slot FIFO.
+ *  @return uint16_t - The number of slots in use, 0 once everything put has been got.
+ *  @note Unlike FIFO_SlotGetStatistics, this does not depend on FIFO_ENABLE_STATISTICS.
+ */
+static inline uint16_t FIFO_SlotNbUsed(const TSlotFIFO* const FIFO)
+{
+  return (uint16_t)(FIFO->Claimed - FIFO->Start);
+}
+
+/*! @brief Take a snapshot of the slot FIFO statistics.
+ *
+ *  @param FIFO A pointer to the slot FIFO.
+ *  @param statisticsPtr A pointer to store the statistics, counted in slots.
+ *  @return bool - TRUE if statistics are enabled (FIFO_ENABLE_STATISTICS).
+ */
+bool FIFO_SlotGetStatistics(const TSlotFIFO* const FIFO, TFIFOStatistics* const statisticsPtr);
 
 #endif
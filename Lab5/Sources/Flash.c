@@ -168,6 +168,58 @@ static bool Flash_WriteN(uint32_t const address, void const *data, uint8_t size)
   return ModifySector(FLASH_DATA_START, phrase);
 }
 
+/*! @brief Handles the "Flash - Program byte" packet
+ *
+ * Command: 0x07
+ * Parameter 1: When 0-7 Address offset, when 8 'erase sector'
+ * Parameter 2: 0
+ * Parameter 3: data
+ *
+ * No response
+ *
+ * @param link The link the packet was received on.
+ * @param packet The received packet.
+ * @return bool - TRUE if the packet was successfully handled.
+ */
+static bool HandleProgramByte(TPacketLink* const link, const TPacket* const packet)
+{
+  // Validate parameters
+  if (Packet_Parameter1(packet) > 8)
+    return false;
+
+  if (Packet_Parameter1(packet) == 8)
+    return Flash_Erase();
+
+  // Write to Flash
+  volatile uint8_t * address =
+      (uint8_t *) (FLASH_DATA_START + Packet_Parameter1(packet));
+  return Flash_Write8(address, Packet_Parameter3(packet));
+}
+
+/*! @brief Handles the "Flash - Read Byte" packet
+ *
+ * Command: 0x08,
+ * Parameter 1: Offset (0-7)
+ * Parameter 2: 0
+ * Parameter 3: 0
+ *
+ * Response: Send the "Flash Byte" packet
+ *
+ * @param link The link the packet was received on.
+ * @param packet The received packet.
+ * @return bool - TRUE if the packet was successfully handled.
+ */
+static bool HandleReadByte(TPacketLink* const link, const TPacket* const packet)
+{
+  if (Packet_Parameter1(packet) > 7)
+    return false;
+
+  // Keep consistent with other impl that dont return false when the packet put fails
+  (void) Packet_Put(link, FLASH_COMMAND_READ_BYTE, Packet_Parameter1(packet), 0,
+      _FB(FLASH_DATA_START + Packet_Parameter1(packet)));
+  return true;
+}
+
 /*!
  * @addtogroup FLASH_module Flash module documentation.
  * @{
@@ -239,6 +291,12 @@ bool Flash_Erase(void)
   return EraseSector(FLASH_DATA_START);
 }
 
+bool Flash_RegisterCommands(TPacketLink* const link)
+{
+  return Packet_Register(link, FLASH_COMMAND_PROGRAM_BYTE, HandleProgramByte, PACKET_PARAMETER2_ZERO)
+      & Packet_Register(link, FLASH_COMMAND_READ_BYTE, HandleReadByte, PACKET_PARAMETER2_ZERO | PACKET_PARAMETER3_ZERO);
+}
+
 /*!
  * @}
  */
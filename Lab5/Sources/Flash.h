@@ -13,6 +13,7 @@
 
 // new types
 #include "types.h"
+#include "packet.h"
 
 // FLASH data access
 #define _FB(flashAddress)  *(uint8_t  volatile *)(flashAddress)
@@ -25,6 +26,10 @@
 // Address of the end of the Flash block we are using for data storage
 #define FLASH_DATA_END   0x00080007LU
 
+// Tower commands implemented by the Flash module
+#define FLASH_COMMAND_PROGRAM_BYTE 0x07 // "Flash - Program Byte" Command
+#define FLASH_COMMAND_READ_BYTE    0x08 // "Flash - Read Byte" Command
+
 /*! @brief Enables the Flash module.
  *
  *  @return bool - TRUE if the Flash was setup successfully.
@@ -80,4 +85,11 @@ bool Flash_Write8(volatile uint8_t* const address, const uint8_t data);
  */
 bool Flash_Erase(void);
 
+/*! @brief Registers the handlers of the Flash commands on a link.
+ *
+ *  @param link The link to receive the commands on.
+ *  @return bool - TRUE if every command was registered.
+ */
+bool Flash_RegisterCommands(TPacketLink* const link);
+
 #endif
@@ -21,6 +21,29 @@
 
 static OS_ECB* callbackSemaphore; /*!< Semaphore used to callback to the RTC processing background thread */
 
+/*! @brief Handles the Set Time PC To Tower Command
+ *
+ * Command: 0x0C
+ * Parameter 1: hours (0-23)
+ * Parameter 2: minutes (0-59)
+ * Parameter 3: seconds (0-59)
+ *
+ *  @param link The link the packet was received on.
+ *  @param packet The received packet.
+ *  @return bool - TRUE if the packet was successfully handled.
+ */
+static bool HandleSetTime(TPacketLink* const link, const TPacket* const packet)
+{
+  // Check that the parameters are a valid time
+  if ((Packet_Parameter1(packet) >= 24) || (Packet_Parameter2(packet) >= 60)
+      || (Packet_Parameter3(packet) >= 60))
+    return false;
+
+  // Set the RTC clock
+  RTC_Set(Packet_Parameter1(packet), Packet_Parameter2(packet), Packet_Parameter3(packet));
+  return true;
+}
+
 bool RTC_Init(OS_ECB* semaphore)
 {
   // Check that the semaphore is valid
@@ -90,6 +113,21 @@ void RTC_Get(uint8_t* const hours, uint8_t* const minutes,
   *seconds = time; // Set seconds output to seconds component of TSR
 }
 
+void RTC_SendTime(TPacketLink* const link)
+{
+  // Get value from the real time clock
+  uint8_t hours, minutes, seconds;
+  RTC_Get(&hours, &minutes, &seconds);
+
+  // Transmit time
+  (void) Packet_PutPriority(link, UART_TX_TIME, RTC_COMMAND_TIME, hours, minutes, seconds);
+}
+
+bool RTC_RegisterCommands(TPacketLink* const link)
+{
+  return Packet_Register(link, RTC_COMMAND_TIME, HandleSetTime, 0);
+}
+
 void __attribute__ ((interrupt)) RTC_ISR(void)
 {
   OS_ISREnter();
@@ -14,6 +14,10 @@
 // new types
 #include "types.h"
 #include "OS.h"
+#include "packet.h"
+
+// Tower command implemented by the RTC module
+#define RTC_COMMAND_TIME 0x0C // "Time" Command
 
 /*! @brief Initializes the RTC before first use.
  *
@@ -42,6 +46,20 @@ void RTC_Set(const uint8_t hours, const uint8_t minutes, const uint8_t seconds);
  */
 void RTC_Get(uint8_t* const hours, uint8_t* const minutes, uint8_t* const seconds);
 
+/*! @brief Sends the "Time" packet, with the value of the real time clock.
+ *
+ *  @param link The link to send on.
+ *  @note Assumes that the RTC module has been initialized.
+ */
+void RTC_SendTime(TPacketLink* const link);
+
+/*! @brief Registers the handler of the "Time" command on a link, which sets the real time clock.
+ *
+ *  @param link The link to receive the command on.
+ *  @return bool - TRUE if the command was registered.
+ */
+bool RTC_RegisterCommands(TPacketLink* const link);
+
 /*! @brief Interrupt service routine for the RTC.
  *
  *  The RTC has incremented one second.
@@ -18,114 +18,997 @@
 #include "UART.h"
 #include "FIFO.h"
 #include "MK70F12.h"
+#include "Cpu.h"
+#include "OS.h"
 
-#define UART2_RDRF (UART2_S1 & UART_S1_RDRF_MASK) // UART2 Receive Data Register Full Flag Mask
-#define UART2_TDRE (UART2_S1 & UART_S1_TDRE_MASK) // UART2 Transmit Data Register Empty Flag Mask
+// Largest error from the requested baud rate that is accepted, in parts per million (receivers tolerate a few percent)
+#define UART_MAX_BAUD_ERROR_PPM 20000
 
-static TFIFO TxFIFO, /*!< The Transmit FIFO Buffer */
-              RxFIFO; /*!< The Receive FIFO Buffer */
+// Maximum OS ticks UART_SetBaudRate waits for the queued messages to be sent at the old baud rate
+#define UART_BAUD_DRAIN_TICKS 100
 
-bool UART_Init(const uint32_t baudRate, const uint32_t moduleClk)
+// Commenting the below out leaves the UART hardware FIFOs disabled
+#define UART_HARDWARE_FIFO
+
+#ifdef UART_HARDWARE_FIFO
+// Transmit Empty is raised when the transmit FIFO holds this many bytes or fewer
+#define UART_TX_WATERMARK 2
+// Receive Full is raised when the receive FIFO holds this many bytes or more (always 1 when receiving by DMA)
+#define UART_RX_WATERMARK 6
+#endif
+
+// Commenting the below out transmits with one interrupt per byte, rather than one DMA transfer per message,
+// on the instances that have a transmit DMA channel
+#define UART_TX_DMA
+
+// Commenting the below out receives with one interrupt per byte, rather than by DMA straight into the receive FIFO,
+// on the instances that have a receive DMA channel
+#define UART_RX_DMA
+
+// Uncommenting the below enables RTS/CTS flow control on the instances with flow control pins.
+// The PC must then drive CTS, or nothing is transmitted
+//#define UART_FLOW_CONTROL
+
+// RTS is deasserted once the receive FIFO has fewer free bytes than this, leaving room for what the PC sends
+// before it notices, and asserted again once the receiving thread has freed this many bytes
+#define UART_RTS_OFF_NB_FREE 32
+#define UART_RTS_ON_NB_FREE 128
+
+// Commenting the below out stops the ISRs timing themselves with the DWT cycle counter
+#define UART_ISR_CYCLES
+
+// Maximum OS ticks a receiver blocked on DMA waits to be woken by the line going idle, or the receive channel reaching
+// the middle or end of the buffer, before collecting the received bytes itself in case a wake up was missed
+#define UART_RX_DMA_TIMEOUT_TICKS 100
+
+// DMA channel number of an instance that does not use DMA
+#define UART_NO_DMA 0xFF
+
+// Priority of the UART interrupts, the same as Processor Expert gives UART2
+#define UART_IRQ_PRIORITY 0x80
+
+// Capacity of each transmit FIFO in messages, and the receive FIFO in bytes
+#define UART_TX_CONTROL_NB_SLOTS 8
+#define UART_TX_TIME_NB_SLOTS 4
+#define UART_TX_TELEMETRY_NB_SLOTS 32
+#define UART_RX_FIFO_SIZE 256
+
+FIFO_DEFINE(RxFIFO, uint8_t, UART_RX_FIFO_SIZE, FIFO_WINDOW_SIZE)
+
+/*!
+ * @struct TUARTConfig
+ *
+ * The fixed hardware resources of a UART instance.
+ */
+typedef struct
+{
+  UART_MemMapPtr Registers;        /*!< The UART module */
+  volatile uint32_t * ClockGate;   /*!< The SIM clock gating register of the module */
+  uint32_t ClockGateMask;          /*!< The module's bit in ClockGate */
+  PORT_MemMapPtr Port;             /*!< The port both pins are on */
+  uint32_t PortClockGateMask;      /*!< The port's bit in SIM_SCGC5 */
+  uint8_t TxPin;                   /*!< The pin number of the transmit pin */
+  uint8_t RxPin;                   /*!< The pin number of the receive pin */
+  uint8_t PinMux;                  /*!< The pin alternative that routes both pins to the module */
+  uint8_t IRQ;                     /*!< The NVIC interrupt number of the RX/TX status interrupt */
+  uint8_t TxDMAChannel;            /*!< The DMA channel for transmitting, or UART_NO_DMA */
+  uint8_t TxDMASource;             /*!< The DMA request source of the transmitter */
+  uint8_t RxDMAChannel;            /*!< The DMA channel for receiving, or UART_NO_DMA */
+  uint8_t RxDMASource;             /*!< The DMA request source of the receiver */
+  GPIO_MemMapPtr FlowControlGPIO;  /*!< The GPIO of the port the flow control pins are on, or NULL if they are not wired */
+  uint8_t CTSPin;                  /*!< The pin number of the clear to send input, routed to the module with PinMux */
+  uint8_t RTSPin;                  /*!< The pin number of the request to send output, driven as a GPIO */
+} TUARTConfig;
+
+struct UARTInstance
+{
+  const TUARTConfig * Config;                                  /*!< The hardware resources of the instance */
+  TFIFOSlot TxControlSlots[UART_TX_CONTROL_NB_SLOTS];          /*!< The storage for the control Transmit FIFO */
+  TFIFOSlot TxTimeSlots[UART_TX_TIME_NB_SLOTS];                /*!< The storage for the time Transmit FIFO */
+  TFIFOSlot TxTelemetrySlots[UART_TX_TELEMETRY_NB_SLOTS];      /*!< The storage for the telemetry Transmit FIFO */
+  TSlotFIFO TxFIFOs[UART_NB_TX_CLASSES];                       /*!< The Transmit FIFO Buffers, one per class, shared by every transmitting thread */
+  TUARTTxClass TxClass;                                        /*!< The class of the message being transmitted */
+  bool TxDMABusy;                                              /*!< TRUE while a message is held by the transmit DMA channel */
+  uint8_t TxFIFODepth;                                         /*!< The number of bytes the hardware transmit FIFO holds */
+  uint16_t RxDMAIndex;                                         /*!< The free running index of the next byte the receive DMA channel will write */
+  TRxFIFO RxFIFO;                                              /*!< The Receive FIFO Buffer */
+  TUARTStatistics Statistics;                                  /*!< The link statistics, updated by the ISR */
+  TUARTBaudRate BaudRate;                                      /*!< The baud rate the UART is running at */
+  uint32_t ModuleClk;                                          /*!< The module clock rate in Hz */
+};
+
+// The instances, with pin routing for the TWR-K70F120M. DMA channels 0 and 1 belong to UART2.
+#ifdef UART_USE_UART0
+static const TUARTConfig UART0Config =
+{
+  UART0_BASE_PTR, &SIM_SCGC4, SIM_SCGC4_UART0_MASK, PORTD_BASE_PTR, SIM_SCGC5_PORTD_MASK,
+  7, 6, 3, 45, UART_NO_DMA, 0, UART_NO_DMA, 0
+};
+TUART UART_Port0 = { .Config = &UART0Config };
+#endif
+
+#ifdef UART_USE_UART1
+static const TUARTConfig UART1Config =
+{
+  UART1_BASE_PTR, &SIM_SCGC4, SIM_SCGC4_UART1_MASK, PORTE_BASE_PTR, SIM_SCGC5_PORTE_MASK,
+  0, 1, 3, 47, UART_NO_DMA, 0, UART_NO_DMA, 0
+};
+TUART UART_Port1 = { .Config = &UART1Config };
+#endif
+
+#ifdef UART_USE_UART2
+static const TUARTConfig UART2Config =
+{
+  UART2_BASE_PTR, &SIM_SCGC4, SIM_SCGC4_UART2_MASK, PORTE_BASE_PTR, SIM_SCGC5_PORTE_MASK,
+  16, 17, 3, 49, 0, 7, 1, 6, // DMA request sources 7 (UART2 transmit) and 6 (UART2 receive)
+  PTE_BASE_PTR, 18, 19 // CTS = PTE18, RTS = PTE19
+};
+TUART UART_Port2 = { .Config = &UART2Config };
+#endif
+
+#ifdef UART_USE_UART3
+static const TUARTConfig UART3Config =
+{
+  UART3_BASE_PTR, &SIM_SCGC4, SIM_SCGC4_UART3_MASK, PORTC_BASE_PTR, SIM_SCGC5_PORTC_MASK,
+  17, 16, 3, 51, UART_NO_DMA, 0, UART_NO_DMA, 0
+};
+TUART UART_Port3 = { .Config = &UART3Config };
+#endif
+
+#ifdef UART_USE_UART4
+static const TUARTConfig UART4Config =
+{
+  UART4_BASE_PTR, &SIM_SCGC1, SIM_SCGC1_UART4_MASK, PORTE_BASE_PTR, SIM_SCGC5_PORTE_MASK,
+  24, 25, 3, 53, UART_NO_DMA, 0, UART_NO_DMA, 0
+};
+TUART UART_Port4 = { .Config = &UART4Config };
+#endif
+
+#ifdef UART_USE_UART5
+static const TUARTConfig UART5Config =
+{
+  UART5_BASE_PTR, &SIM_SCGC1, SIM_SCGC1_UART5_MASK, PORTE_BASE_PTR, SIM_SCGC5_PORTE_MASK,
+  8, 9, 3, 55, UART_NO_DMA, 0, UART_NO_DMA, 0
+};
+TUART UART_Port5 = { .Config = &UART5Config };
+#endif
+
+/*! @brief Check if an instance uses RTS/CTS flow control.
+ *
+ *  @param config The hardware resources of the instance.
+ *  @return bool - TRUE if the flow control pins are used.
+ */
+static inline bool UsesFlowControl(const TUARTConfig * const config)
+{
+#ifdef UART_FLOW_CONTROL
+  return config->FlowControlGPIO != NULL;
+#else
+  return false;
+#endif
+}
+
+/*! @brief Check if an instance transmits by DMA.
+ *
+ *  @param config The hardware resources of the instance.
+ *  @return bool - TRUE if messages are transmitted by DMA.
+ */
+static inline bool UsesTxDMA(const TUARTConfig * const config)
+{
+#ifdef UART_TX_DMA
+  return config->TxDMAChannel != UART_NO_DMA;
+#else
+  return false;
+#endif
+}
+
+/*! @brief Check if an instance receives by DMA.
+ *
+ *  @param config The hardware resources of the instance.
+ *  @return bool - TRUE if bytes are received by DMA.
+ */
+static inline bool UsesRxDMA(const TUARTConfig * const config)
+{
+#ifdef UART_RX_DMA
+  // The channel writes into the receive FIFO without interrupting, so it could not deassert RTS in time
+  return config->RxDMAChannel != UART_NO_DMA && !UsesFlowControl(config);
+#else
+  return false;
+#endif
+}
+
+#ifdef UART_HARDWARE_FIFO
+/*! @brief Decode the size of a hardware FIFO.
+ *
+ *  @param fifoSize The TXFIFOSIZE or RXFIFOSIZE field of PFIFO.
+ *  @return uint8_t - The number of bytes the FIFO holds.
+ */
+static uint8_t FIFODepth(const uint8_t fifoSize)
+{
+  // 0 is a single data register, then 4, 8, 16... bytes
+  return (fifoSize == 0) ? 1 : (2 << fifoSize);
+}
+#endif
+
+bool UART_CalculateBaudRate(const uint32_t baudRate, const uint32_t moduleClk, TUARTBaudRate * const settingsPtr)
+{
+  if (baudRate == 0)
+    return false;
+
+  // UART baud rate = UART module clock / (16 * (SBR[12:0] + BRFA / 32))
+  // so the divisor in 32nds, 32 * SBR + BRFA = 2 * UART module clock / UART baud rate.
+  // Rounding to the nearest 32nd (rather than truncating the clock ratio first) uses the full resolution of BRFA
+  const uint32_t divisor = (uint32_t) (((2 * (uint64_t) moduleClk) + (baudRate / 2)) / baudRate);
+
+  // SBR is 13 bits, and 0 turns the baud rate generator off
+  if (divisor < 32 || divisor >= 32 * 8192)
+    return false;
+
+  settingsPtr->BaudRate = baudRate;
+  settingsPtr->SBR = (uint16_t) (divisor / 32);
+  settingsPtr->BRFA = (uint8_t) (divisor % 32);
+  settingsPtr->AchievedBaudRate = (uint32_t) (((2 * (uint64_t) moduleClk) + (divisor / 2)) / divisor);
+
+  // Error = (2 * UART module clock / divisor - UART baud rate) / UART baud rate, kept exact by scaling before dividing
+  const int64_t product = (int64_t) baudRate * divisor;
+  settingsPtr->ErrorPPM = (int32_t) (((2 * (int64_t) moduleClk - product) * 1000000) / product);
+
+  return (settingsPtr->ErrorPPM <= UART_MAX_BAUD_ERROR_PPM) && (settingsPtr->ErrorPPM >= -UART_MAX_BAUD_ERROR_PPM);
+}
+
+/*! @brief Deassert RTS once the receive FIFO is nearly full, asking the PC to stop sending.
+ *
+ *  @param uart The UART instance, which uses flow control.
+ *  @note Called from the ISR after receiving.
+ */
+static inline void CheckRTSOff(TUART * const uart)
+{
+  const uint16_t nbFree = UART_RX_FIFO_SIZE - (uint16_t)(uart->RxFIFO.State.End - uart->RxFIFO.State.Start);
+
+  // RTS is active low
+  if (nbFree < UART_RTS_OFF_NB_FREE)
+    GPIO_PSOR_REG(uart->Config->FlowControlGPIO) = 1 << uart->Config->RTSPin;
+}
+
+/*! @brief Assert RTS once the receiving thread has made enough room, letting the PC send again.
+ *
+ *  @param uart The UART instance.
+ *  @note Called by receiving threads after removing bytes.
+ */
+static void CheckRTSOn(TUART * const uart)
+{
+  if (!UsesFlowControl(uart->Config))
+    return;
+
+  // Stop the ISR deasserting RTS between the check and asserting it
+  EnterCritical();
+
+  const uint16_t nbFree = UART_RX_FIFO_SIZE - (uint16_t)(uart->RxFIFO.State.End - uart->RxFIFO.State.Start);
+
+  if (nbFree >= UART_RTS_ON_NB_FREE)
+    GPIO_PCOR_REG(uart->Config->FlowControlGPIO) = 1 << uart->Config->RTSPin;
+
+  ExitCritical();
+}
+
+/*! @brief Program the baud rate generator.
+ *
+ *  @param uart The UART instance.
+ *  @param settingsPtr The divisor settings from UART_CalculateBaudRate.
+ */
+static void ApplyBaudRate(TUART * const uart, const TUARTBaudRate * const settingsPtr)
+{
+  const UART_MemMapPtr registers = uart->Config->Registers;
+
+  // Set fine adjust 5 bits, replacing the previous value
+  UART_C4_REG(registers) = (UART_C4_REG(registers) & ~UART_C4_BRFA_MASK) | UART_C4_BRFA(settingsPtr->BRFA);
+
+  // Set baud rate divisor 13-bit modulus counter, the new divisor takes effect once the low bits are written
+  UART_BDH_REG(registers) = (UART_BDH_REG(registers) & ~UART_BDH_SBR_MASK) | UART_BDH_SBR(settingsPtr->SBR >> 8); // Set 5 high bits
+  UART_BDL_REG(registers) = UART_BDL_SBR(settingsPtr->SBR); // Set 8 Low bits
+
+  uart->BaudRate = *settingsPtr;
+}
+
+bool UART_Init(TUART * const uart, const uint32_t baudRate, const uint32_t moduleClk)
 {
+  const TUARTConfig * const config = uart->Config;
+  const UART_MemMapPtr registers = config->Registers;
+  TUARTBaudRate settings;
+
+  if (!UART_CalculateBaudRate(baudRate, moduleClk, &settings))
+    return false;
+
   // Initialise the circular FIFO buffers for Received and Transmitted data
-  FIFO_Init(&TxFIFO); // Initialise the Transmit FIFO
-  FIFO_Init(&RxFIFO); // Initialise the Receive FIFO
-
-  // Enable UART2
-  SIM_SCGC4 |= SIM_SCGC4_UART2_MASK;
-
-  // Enable Pin Routing for Port E
-  SIM_SCGC5 |= SIM_SCGC5_PORTE_MASK;
-
-  // Configure multiplexed PINs Port E 16, 17 for UART2 usage (K70P256M150SF3RM.pdf p. 280)
-  PORTE_PCR16 = PORT_PCR_MUX(3); // UART2_TX = PTE16 ALT3
-  PORTE_PCR17 = PORT_PCR_MUX(3); // UART2_RX = PTE17 ALT3
-
-  // Generate / Set baud rate (K70P256M150SF3RM.pdf, p. 1973)
-
-  // UART baud rate = UART module clock / (16 * (SBR[12:0] + BRFD))
-  // 16 * (SBR[12:0] + BRFD) =  UART module clock / UART baud rate
-  //
-  // BRFD < 1 and will be represented as a 5 bit integer (0-31). Multiply by 2 to avoid floating point calculations.
-  // 32 * (SBR[12:0] + BRFD) =  2 x (UART module clock / UART baud rate)
-  const uint32_t baudRateDivisor = 2 * (moduleClk / baudRate); // = 32 * (SBR[12:0] + BRFD)
-
-  // Split SBR and BRFD, as BRFD < 1 we can use integer division to split
-  // baudRateDivisor = 32 * (SBR[12:0] + BRFD), SBR > 1 and BRFD < 1
-  const uint16_t sbr = baudRateDivisor / 32;
-  const uint16_t brfd = baudRateDivisor % 32;
-
-  // Set baud rate divisor 13-bit modulus counter
-  UART2_BDH = (uint8_t) ((sbr >> 8) & 0x1F); // Set 5 high bits
-  UART2_BDL = (uint8_t) sbr; // Set 8 Low bits
-
-  // Set fine adjust 5 bits
-  UART2_C4 |= brfd & UART_C4_BRFA_MASK;
-
-  UART2_C1 &= ~UART_C1_LOOPS_MASK; // LOOPS - Normal mode
-  UART2_C1 &= ~UART_C1_UARTSWAI_MASK; // UART clock continues to run in Wait mode
-  UART2_C1 &= ~UART_C1_RSRC_MASK; // Internal Loop Back Mode
-  UART2_C1 &= ~UART_C1_M_MASK; // Normal 8 bit mode
-  UART2_C1 &= ~UART_C1_WAKE_MASK; // Idle Line Wakeup
-  UART2_C1 &= ~UART_C1_ILT_MASK; // Idle character bit count starts after start bit
-  UART2_C1 &= ~UART_C1_PE_MASK; // Parity function disabled
-  UART2_C1 &= ~UART_C1_PT_MASK; // Even parity
-
-  UART2_C2 &= ~UART_C2_TIE_MASK; // Disable Transmit Empty Interrupts
-  UART2_C2 |= UART_C2_RIE_MASK; // Enable Receive Full Interrupts
-  UART2_C2 |= UART_C2_TE_MASK; // Enable Transmit
-  UART2_C2 |= UART_C2_RE_MASK; // Enable Receive
-  UART2_C2 &= ~UART_C2_TCIE_MASK; // Disable Transmit Complete Interrupts
-  UART2_C2 &= ~UART_C2_ILIE_MASK; // Disable Idle Line Interrupts
-  UART2_C2 &= ~UART_C2_RWU_MASK; // Receiver Wakeup - Normal Mode
-  UART2_C2 &= ~UART_C2_SBK_MASK; // Send Break - Normal Mode
+  FIFO_SlotInit(&uart->TxFIFOs[UART_TX_CONTROL], uart->TxControlSlots, UART_TX_CONTROL_NB_SLOTS); // Initialise the Transmit FIFOs
+  FIFO_SlotInit(&uart->TxFIFOs[UART_TX_TIME], uart->TxTimeSlots, UART_TX_TIME_NB_SLOTS);
+  FIFO_SlotInit(&uart->TxFIFOs[UART_TX_TELEMETRY], uart->TxTelemetrySlots, UART_TX_TELEMETRY_NB_SLOTS);
+  uart->TxClass = UART_TX_CONTROL;
+
+  // Stale telemetry is worth less than new telemetry, so a backed up link drops the oldest
+  FIFO_SlotSetDropOldest(&uart->TxFIFOs[UART_TX_TELEMETRY], true);
+
+  RxFIFO_Init(&uart->RxFIFO); // Initialise the Receive FIFO
+  memset(&uart->Statistics, 0, sizeof(uart->Statistics));
+  uart->Statistics.MinISRCycles = UINT32_MAX;
+  uart->TxFIFODepth = 1;
+
+  // Enable the UART module
+  *config->ClockGate |= config->ClockGateMask;
+
+  // Enable Pin Routing for the port
+  SIM_SCGC5 |= config->PortClockGateMask;
+
+  // Configure the multiplexed pins for UART usage (K70P256M150SF3RM.pdf p. 280)
+  PORT_PCR_REG(config->Port, config->TxPin) = PORT_PCR_MUX(config->PinMux);
+  PORT_PCR_REG(config->Port, config->RxPin) = PORT_PCR_MUX(config->PinMux);
+
+#ifdef UART_ISR_CYCLES
+  // Enable the DWT cycle counter, which the ISRs time themselves with (DEMCR TRCENA, then DWT_CTRL CYCCNTENA)
+  DEMCR |= 1 << 24;
+  DWT_CTRL |= 1;
+#endif
+
+  // Set baud rate (K70P256M150SF3RM.pdf, p. 1973)
+  uart->ModuleClk = moduleClk;
+  ApplyBaudRate(uart, &settings);
+
+  UART_C1_REG(registers) &= ~UART_C1_LOOPS_MASK; // LOOPS - Normal mode
+  UART_C1_REG(registers) &= ~UART_C1_UARTSWAI_MASK; // UART clock continues to run in Wait mode
+  UART_C1_REG(registers) &= ~UART_C1_RSRC_MASK; // Internal Loop Back Mode
+  UART_C1_REG(registers) &= ~UART_C1_M_MASK; // Normal 8 bit mode
+  UART_C1_REG(registers) &= ~UART_C1_WAKE_MASK; // Idle Line Wakeup
+  UART_C1_REG(registers) |= UART_C1_ILT_MASK; // Idle character bit count starts after stop bit, so data bits are never mistaken for idle
+  UART_C1_REG(registers) &= ~UART_C1_PE_MASK; // Parity function disabled
+  UART_C1_REG(registers) &= ~UART_C1_PT_MASK; // Even parity
+
+#ifdef UART_HARDWARE_FIFO
+  // The hardware FIFOs can only be enabled while the transmitter and receiver are disabled
+  UART_C2_REG(registers) &= ~(UART_C2_TE_MASK | UART_C2_RE_MASK);
+  UART_PFIFO_REG(registers) |= UART_PFIFO_TXFE_MASK | UART_PFIFO_RXFE_MASK;
+  UART_CFIFO_REG(registers) |= UART_CFIFO_TXFLUSH_MASK | UART_CFIFO_RXFLUSH_MASK;
+
+  // The FIFO sizes depend on the UART, so the watermarks are limited to what this one holds
+  uart->TxFIFODepth = FIFODepth((UART_PFIFO_REG(registers) & UART_PFIFO_TXFIFOSIZE_MASK) >> UART_PFIFO_TXFIFOSIZE_SHIFT);
+  const uint8_t rxFIFODepth = FIFODepth((UART_PFIFO_REG(registers) & UART_PFIFO_RXFIFOSIZE_MASK) >> UART_PFIFO_RXFIFOSIZE_SHIFT);
+
+  UART_TWFIFO_REG(registers) = (UART_TX_WATERMARK < uart->TxFIFODepth) ? UART_TX_WATERMARK : uart->TxFIFODepth - 1;
+
+  // Each DMA request only moves one byte, so bytes below a higher watermark would never be moved
+  if (UsesRxDMA(config))
+    UART_RWFIFO_REG(registers) = 1;
+  else
+    UART_RWFIFO_REG(registers) = (UART_RX_WATERMARK < rxFIFODepth) ? UART_RX_WATERMARK : rxFIFODepth;
+#endif
+
+  if (UsesFlowControl(config))
+  {
+    // The transmitter holds off while CTS is deasserted, finishing the character it is sending
+    PORT_PCR_REG(config->Port, config->CTSPin) = PORT_PCR_MUX(config->PinMux);
+    UART_MODEM_REG(registers) |= UART_MODEM_TXCTSE_MASK;
+
+    // RTS follows the receive FIFO rather than the hardware FIFO, so it is driven as a GPIO, starting asserted (low)
+    GPIO_PCOR_REG(config->FlowControlGPIO) = 1 << config->RTSPin;
+    GPIO_PDDR_REG(config->FlowControlGPIO) |= 1 << config->RTSPin;
+    PORT_PCR_REG(config->Port, config->RTSPin) = PORT_PCR_MUX(1);
+  }
+
+  UART_C2_REG(registers) &= ~UART_C2_TIE_MASK; // Disable Transmit Empty Interrupts
+  UART_C2_REG(registers) |= UART_C2_RIE_MASK; // Enable Receive Full Interrupts
+  UART_C2_REG(registers) |= UART_C2_TE_MASK; // Enable Transmit
+  UART_C2_REG(registers) |= UART_C2_RE_MASK; // Enable Receive
+  UART_C2_REG(registers) &= ~UART_C2_TCIE_MASK; // Disable Transmit Complete Interrupts
+  UART_C2_REG(registers) |= UART_C2_ILIE_MASK; // Enable Idle Line Interrupts, to flush the receive FIFO at the end of a burst
+  UART_C2_REG(registers) &= ~UART_C2_RWU_MASK; // Receiver Wakeup - Normal Mode
+  UART_C2_REG(registers) &= ~UART_C2_SBK_MASK; // Send Break - Normal Mode
+
+  if (UsesTxDMA(config))
+  {
+    const uint8_t channel = config->TxDMAChannel;
+
+    // Enable DMA and the DMA request multiplexer
+    SIM_SCGC6 |= SIM_SCGC6_DMAMUX0_MASK;
+    SIM_SCGC7 |= SIM_SCGC7_DMA_MASK;
+
+    // Each request moves one byte from the message to the UART data register,
+    // and the channel stops taking requests at the end of each message
+    DMAMUX0_CHCFG(channel) = 0;
+    DMA_SOFF(channel) = 1;
+    DMA_ATTR(channel) = DMA_ATTR_SSIZE(0) | DMA_ATTR_DSIZE(0);
+    DMA_NBYTES_MLNO(channel) = 1;
+    DMA_SLAST(channel) = 0;
+    DMA_DADDR(channel) = (uint32_t) &UART_D_REG(registers);
+    DMA_DOFF(channel) = 0;
+    DMA_DLAST_SGA(channel) = 0;
+    DMA_CSR(channel) = DMA_CSR_DREQ_MASK;
+    DMAMUX0_CHCFG(channel) = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(config->TxDMASource);
+    uart->TxDMABusy = false;
+
+    // Transmit Empty now requests DMA rather than interrupting, and is only serviced while the channel is running
+    UART_C5_REG(registers) |= UART_C5_TDMAS_MASK;
+    UART_C2_REG(registers) |= UART_C2_TIE_MASK;
+  }
+
+  if (UsesRxDMA(config))
+  {
+    const uint8_t channel = config->RxDMAChannel;
+
+    // Enable DMA and the DMA request multiplexer
+    SIM_SCGC6 |= SIM_SCGC6_DMAMUX0_MASK;
+    SIM_SCGC7 |= SIM_SCGC7_DMA_MASK;
+
+    // Each request moves one byte from the UART data register into the receive FIFO buffer.
+    // The destination wraps back to the start of the buffer at the end of each major loop, and the channel never stops.
+    DMAMUX0_CHCFG(channel) = 0;
+    DMA_SADDR(channel) = (uint32_t) &UART_D_REG(registers);
+    DMA_SOFF(channel) = 0;
+    DMA_ATTR(channel) = DMA_ATTR_SSIZE(0) | DMA_ATTR_DSIZE(0);
+    DMA_NBYTES_MLNO(channel) = 1;
+    DMA_SLAST(channel) = 0;
+    DMA_DADDR(channel) = (uint32_t) &uart->RxFIFO.Buffer[0];
+    DMA_DOFF(channel) = 1;
+    DMA_CITER_ELINKNO(channel) = DMA_CITER_ELINKNO_CITER(UART_RX_FIFO_SIZE);
+    DMA_BITER_ELINKNO(channel) = DMA_BITER_ELINKNO_BITER(UART_RX_FIFO_SIZE);
+    DMA_DLAST_SGA(channel) = (uint32_t) -UART_RX_FIFO_SIZE;
+    DMA_CSR(channel) = DMA_CSR_INTHALF_MASK | DMA_CSR_INTMAJOR_MASK; // Interrupt half way through and at the end of the buffer
+    DMAMUX0_CHCFG(channel) = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(config->RxDMASource);
+    uart->RxDMAIndex = 0;
+    DMA_SERQ = DMA_SERQ_SERQ(channel);
+
+    // Receive Full now requests DMA rather than interrupting, leaving only the idle line to interrupt
+    UART_C5_REG(registers) |= UART_C5_RDMAS_MASK;
+
+    // DMA channel n interrupts on IRQ n, so a line that never goes idle still wakes the receiver every half buffer
+    NVIC_IP(channel) = UART_IRQ_PRIORITY;
+    NVIC_ICPR(channel / 32) = 1 << (channel % 32);
+    NVIC_ISER(channel / 32) = 1 << (channel % 32);
+  }
+
+  // Processor Expert only enables the UART2 interrupt, so enable the instance's own
+  NVIC_IP(config->IRQ) = UART_IRQ_PRIORITY;
+  NVIC_ICPR(config->IRQ / 32) = 1 << (config->IRQ % 32);
+  NVIC_ISER(config->IRQ / 32) = 1 << (config->IRQ % 32);
 
   return true;
 }
 
-void UART_InChar(uint8_t * const dataPtr)
+/*! @brief Make the bytes the receive DMA channel has written since last time available in the receive FIFO.
+ *
+ *  @param uart The UART instance, which receives by DMA.
+ *  @note Called from the ISRs when the line goes idle or the channel is half way through or at the end of the buffer,
+ *        and by receiving threads.
+ */
+static void PublishRxDMA(TUART * const uart)
+{
+  TRxFIFO * const rxFIFO = &uart->RxFIFO;
+
+  // Hold off the ISR (or another thread) while acting as the receive FIFO producer
+  EnterCritical();
+
+  // The channel counts CITER down from the buffer size, reloading it at the end of the buffer
+  const uint16_t position = UART_RX_FIFO_SIZE - DMA_CITER_ELINKNO(uart->Config->RxDMAChannel);
+  const uint16_t nbArrived = (uint16_t)(position - uart->RxDMAIndex) & (UART_RX_FIFO_SIZE - 1);
+  const uint16_t index = uart->RxDMAIndex + nbArrived;
+  const uint16_t start = rxFIFO->State.Start;
+  const uint16_t nbFree = UART_RX_FIFO_SIZE - (uint16_t)(rxFIFO->State.End - start);
+  uint16_t nbBytes = index - rxFIFO->State.End;
+
+  // A byte written from a buffer length past the oldest unread byte overwrote unread data. Only the bytes written
+  // since the last time are counted, so an overrun the consumer has not caught up with yet is only counted once
+  const uint16_t overrunIndex = start + UART_RX_FIFO_SIZE;
+  const uint16_t firstNewIndex = ((int16_t)(overrunIndex - uart->RxDMAIndex) > 0) ? overrunIndex : uart->RxDMAIndex;
+
+  if ((int16_t)(index - firstNewIndex) > 0)
+    FIFO_Dropped(&rxFIFO->State, index - firstNewIndex);
+
+  uart->RxDMAIndex = index;
+  uart->Statistics.NbRxBytes += nbArrived;
+
+  // No more than the free space can be made available
+  if (nbBytes > nbFree)
+    nbBytes = nbFree;
+
+  // The channel writes straight into the buffer and wraps to the front itself,
+  // so commit in at most two segments that each stop at the end of the buffer
+  while (nbBytes > 0)
+  {
+    const uint16_t offset = rxFIFO->State.End & (UART_RX_FIFO_SIZE - 1);
+    const uint16_t segmentNbBytes = (nbBytes < UART_RX_FIFO_SIZE - offset) ? nbBytes : UART_RX_FIFO_SIZE - offset;
+
+    RxFIFO_Commit(rxFIFO, segmentNbBytes);
+    nbBytes -= segmentNbBytes;
+  }
+
+  ExitCritical();
+}
+
+void UART_InChar(TUART * const uart, uint8_t * const dataPtr)
 {
   // Get data from the received FIFO buffer
-  FIFO_BlockingGet(&RxFIFO, dataPtr);
+  UART_InChars(uart, dataPtr, 1);
 }
 
-bool UART_OutChar(const uint8_t data)
+void UART_InChars(TUART * const uart, uint8_t * const dataPtr, const uint16_t nbBytes)
+{
+  // With flow control the PC stops sending before the receive FIFO is full, so never wait for more than arrives by then
+  const uint16_t maxBatchNbBytes = UsesFlowControl(uart->Config) ?
+      UART_RX_FIFO_SIZE - UART_RTS_OFF_NB_FREE : UART_RX_FIFO_SIZE;
+  uint32_t received = 0;
+
+  // Get the data from the received FIFO buffer up to a whole FIFO at a time
+  while (received < nbBytes)
+  {
+    const uint16_t remaining = nbBytes - received;
+    const uint16_t batchNbBytes = (remaining < maxBatchNbBytes) ? remaining : maxBatchNbBytes;
+
+    if (UsesRxDMA(uart->Config))
+    {
+      // Waits are woken by the DMA and idle line interrupts, and only time out if a wake up was missed
+      do
+        PublishRxDMA(uart);
+      while (!RxFIFO_TimedGetN(&uart->RxFIFO, dataPtr + received, batchNbBytes, UART_RX_DMA_TIMEOUT_TICKS));
+    }
+    else
+    {
+      RxFIFO_BlockingGetN(&uart->RxFIFO, dataPtr + received, batchNbBytes);
+      CheckRTSOn(uart);
+    }
+
+    received += batchNbBytes;
+  }
+}
+
+bool UART_OutChar(TUART * const uart, const uint8_t data)
 {
   // Add data to the transmit FIFO buffer
-  FIFO_BlockingPut(&TxFIFO, data);
-  UART2_C2 |= UART_C2_TIE_MASK;
+  return UART_OutChars(uart, &data, 1);
 }
 
-void __attribute__ ((interrupt)) UART_ISR(void)
+bool UART_OutChars(TUART * const uart, const uint8_t * const dataPtr, const uint16_t nbBytes)
 {
-  OS_ISREnter();
+  uint32_t sent;
 
-  uint8_t txData;
+  // Add the data to the transmit FIFO buffer a slot at a time,
+  // enabling the transmitter after each so a full FIFO always drains
+  for (sent = 0; sent < nbBytes; sent += FIFO_SLOT_SIZE)
+  {
+    const uint16_t remaining = nbBytes - sent;
+    const uint8_t slotNbBytes = (remaining < FIFO_SLOT_SIZE) ? remaining : FIFO_SLOT_SIZE;
+    uint8_t * const slotPtr = UART_OutReserve(uart, UART_TX_CONTROL, 0);
+
+    memcpy(slotPtr, dataPtr + sent, slotNbBytes);
+    UART_OutCommit(uart, UART_TX_CONTROL, slotPtr, slotNbBytes);
+  }
+
+  return true;
+}
+
+const uint8_t * UART_InPeek(TUART * const uart, const uint16_t nbBytes)
+{
+  const uint8_t * dataPtr;
+
+  // Wait for the data to be in the received FIFO buffer, and examine it there
+  if (!UsesRxDMA(uart->Config))
+    return RxFIFO_BlockingPeek(&uart->RxFIFO, nbBytes);
+
+  // When receiving by DMA, wait to be woken by the DMA and idle line interrupts, collecting the data on a time out
+  do
+    PublishRxDMA(uart);
+  while (!(dataPtr = RxFIFO_TimedPeek(&uart->RxFIFO, nbBytes, UART_RX_DMA_TIMEOUT_TICKS)));
+
+  return dataPtr;
+}
+
+void UART_InConsume(TUART * const uart, const uint16_t nbBytes)
+{
+  RxFIFO_Consume(&uart->RxFIFO, nbBytes);
+  CheckRTSOn(uart);
+}
+
+uint16_t UART_InNbBytes(TUART * const uart)
+{
+  // When receiving by DMA, first collect what the DMA channel has received
+  if (UsesRxDMA(uart->Config))
+    PublishRxDMA(uart);
+
+  return RxFIFO_NbElements(&uart->RxFIFO);
+}
+
+uint8_t * UART_OutReserve(TUART * const uart, const TUARTTxClass txClass, const uint32_t timeout)
+{
+  // Wait for a free slot in the transmit FIFO buffer, and build the data there
+  return FIFO_SlotReserve(&uart->TxFIFOs[txClass], timeout);
+}
+
+void UART_OutCommit(TUART * const uart, const TUARTTxClass txClass, uint8_t * const dataPtr, const uint8_t nbBytes)
+{
+  FIFO_SlotCommit(&uart->TxFIFOs[txClass], dataPtr, nbBytes);
+
+  // By DMA, Transmit Complete interrupts as soon as the line is idle to start the next transfer.
+  // Otherwise Transmit Empty interrupts for each byte
+  if (UsesTxDMA(uart->Config))
+    UART_C2_REG(uart->Config->Registers) |= UART_C2_TCIE_MASK;
+  else
+    UART_C2_REG(uart->Config->Registers) |= UART_C2_TIE_MASK;
+}
+
+void UART_SetDropOldest(TUART * const uart, const TUARTTxClass txClass, const bool dropOldest)
+{
+  FIFO_SlotSetDropOldest(&uart->TxFIFOs[txClass], dropOldest);
+}
+
+void UART_SetReceiveThreshold(TUART * const uart, const uint16_t nbBytes)
+{
+  RxFIFO_SetWakeThreshold(&uart->RxFIFO, nbBytes);
+}
+
+bool UART_GetTxStatistics(TUART * const uart, const TUARTTxClass txClass, TFIFOStatistics * const statisticsPtr)
+{
+  return FIFO_SlotGetStatistics(&uart->TxFIFOs[txClass], statisticsPtr);
+}
+
+bool UART_GetRxStatistics(TUART * const uart, TFIFOStatistics * const statisticsPtr)
+{
+  return RxFIFO_GetStatistics(&uart->RxFIFO, statisticsPtr);
+}
+
+void UART_GetStatistics(TUART * const uart, TUARTStatistics * const statisticsPtr)
+{
+  // Stop the ISR updating the statistics part way through the copy
+  EnterCritical();
+  *statisticsPtr = uart->Statistics;
+  ExitCritical();
+
+  if (statisticsPtr->NbInterrupts == 0)
+    statisticsPtr->MinISRCycles = 0;
+}
+
+/*! @brief Check that every queued message has been shifted out.
+ *
+ *  @param uart The UART instance.
+ *  @return bool - TRUE if the transmit FIFOs are empty and the transmitter is idle.
+ */
+static bool IsTxDrained(TUART * const uart)
+{
+  TUARTTxClass txClass;
+
+  // A slot being sent by DMA stays in use until the channel is done with it
+  for (txClass = UART_TX_CONTROL; txClass < UART_NB_TX_CLASSES; txClass++)
+    if (FIFO_SlotNbUsed(&uart->TxFIFOs[txClass]) != 0)
+      return false;
+
+  // Transmission Complete is only set once the hardware FIFO and the shift register are empty
+  return (UART_S1_REG(uart->Config->Registers) & UART_S1_TC_MASK) != 0;
+}
+
+bool UART_SetBaudRate(TUART * const uart, const uint32_t baudRate)
+{
+  TUARTBaudRate settings;
+  uint32_t nbTicks;
 
-  // Check if data ready to read from UART2
-  if ((UART2_C2 & UART_C2_RIE_MASK) && UART2_RDRF)
+  if (!UART_CalculateBaudRate(baudRate, uart->ModuleClk, &settings))
+    return false;
+
+  // Let what was queued before the switch go out at the old baud rate, but never wait forever on a busy link
+  for (nbTicks = 0; nbTicks < UART_BAUD_DRAIN_TICKS && !IsTxDrained(uart); nbTicks++)
+    OS_TimeDelay(1);
+
+  EnterCritical();
+  ApplyBaudRate(uart, &settings);
+  ExitCritical();
+
+  return true;
+}
+
+void UART_GetBaudRate(TUART * const uart, TUARTBaudRate * const settingsPtr)
+{
+  *settingsPtr = uart->BaudRate;
+}
+
+/*! @brief Complete clearing the IDLE flag, once S1 has been read.
+ *
+ *  @param registers The UART module.
+ *  @note Only call this while no received byte is waiting, as it would be read and lost.
+ */
+static inline void ClearIdle(const UART_MemMapPtr registers)
+{
+  // Reading the data register completes clearing the IDLE flag
+  (void) UART_D_REG(registers);
+
+#ifdef UART_HARDWARE_FIFO
+  // Reading the empty receive FIFO flags an underflow, which is expected here
+  UART_SFIFO_REG(registers) = UART_SFIFO_RXUF_MASK;
+#endif
+}
+
+/*! @brief Once the previous message has been sent, start the DMA transfer of the next one.
+ *
+ *  @param uart The UART instance, which transmits by DMA.
+ *  @param config The hardware resources of the instance.
+ *  @note Called from the ISR when transmission is complete.
+ */
+static inline void ServiceTxDMA(TUART * const uart, const TUARTConfig * const config)
+{
+  const uint8_t channel = config->TxDMAChannel;
+  const uint8_t * dataPtr = NULL;
+  uint8_t nbBytes;
+  TUARTTxClass txClass;
+
+  if (uart->TxDMABusy)
   {
-    // Read from UART2 data register into the receive FIFO buffer
-    FIFO_Put(&RxFIFO, UART2_D);
+    // Transmission Complete is still set for the moment before the channel writes the first byte
+    if (!(DMA_CSR(channel) & DMA_CSR_DONE_MASK))
+      return;
+
+    DMA_CDNE = DMA_CDNE_CDNE(channel);
+    FIFO_SlotRelease(&uart->TxFIFOs[uart->TxClass]);
+    uart->TxDMABusy = false;
   }
 
-  // Check if UART2 is ready to transmit and there is data waiting in transmit FIFO buffer
-  if ((UART2_C2 & UART_C2_TIE_MASK) && UART2_TDRE)
+  // Send the oldest message of the highest priority class next
+  for (txClass = UART_TX_CONTROL; txClass < UART_NB_TX_CLASSES && !dataPtr; txClass++)
+  {
+    dataPtr = FIFO_SlotGetAll(&uart->TxFIFOs[txClass], &nbBytes);
+    uart->TxClass = txClass;
+  }
+
+  if (!dataPtr)
+  {
+    // Nothing left to send, so disable Transmit Complete Interrupts until the next commit
+    UART_C2_REG(config->Registers) &= ~UART_C2_TCIE_MASK;
+    return;
+  }
+
+  uart->Statistics.NbTxBytes += nbBytes;
+
+  // The whole message is contiguous in its slot, so it is sent as one major loop
+  DMA_SADDR(channel) = (uint32_t) dataPtr;
+  DMA_CITER_ELINKNO(channel) = DMA_CITER_ELINKNO_CITER(nbBytes);
+  DMA_BITER_ELINKNO(channel) = DMA_BITER_ELINKNO_BITER(nbBytes);
+  uart->TxDMABusy = true;
+  DMA_SERQ = DMA_SERQ_SERQ(channel);
+}
+
+/*! @brief Move every byte waiting in the receiver into the receive FIFO buffer.
+ *
+ *  @param uart The UART instance.
+ *  @param registers The UART module.
+ *  @param status The value of S1 read on entry to the ISR.
+ *  @return bool - TRUE if any bytes were read, which also completes clearing the IDLE flag.
+ */
+static inline bool ReceiveBytes(TUART * const uart, const UART_MemMapPtr registers, const uint8_t status)
+{
+#ifdef UART_HARDWARE_FIFO
+  uint8_t nbBytes = UART_RCFIFO_REG(registers);
+#else
+  uint8_t nbBytes = (status & UART_S1_RDRF_MASK) ? 1 : 0;
+#endif
+  const bool received = nbBytes > 0;
+
+  uart->Statistics.NbRxBytes += nbBytes;
+
+  // If the buffer is full the byte is dropped, and counted in the FIFO statistics
+  while (nbBytes-- > 0)
+    (void) RxFIFO_Put(&uart->RxFIFO, UART_D_REG(registers));
+
+  return received;
+}
+
+/*! @brief Get the next byte to transmit, from the highest priority class with a message waiting.
+ *
+ *  @param uart The UART instance.
+ *  @param dataPtr A pointer to store the byte.
+ *  @return bool - TRUE if there was a byte to transmit.
+ */
+static bool GetTxByte(TUART * const uart, uint8_t * const dataPtr)
+{
+  TUARTTxClass txClass;
+
+  // Finish the message being transmitted first, so messages are never interleaved
+  if (FIFO_SlotIsGetting(&uart->TxFIFOs[uart->TxClass]))
+    return FIFO_SlotGet(&uart->TxFIFOs[uart->TxClass], dataPtr);
+
+  // Then start the oldest message of the highest priority class
+  for (txClass = UART_TX_CONTROL; txClass < UART_NB_TX_CLASSES; txClass++)
   {
-    if (FIFO_Get(&TxFIFO, &txData))
+    if (FIFO_SlotGet(&uart->TxFIFOs[txClass], dataPtr))
     {
-      // Write to UART2 data register
-      UART2_D = txData;
+      uart->TxClass = txClass;
+      return true;
     }
-    else
+  }
+
+  return false;
+}
+
+/*! @brief Fill the transmitter from the transmit FIFO buffers.
+ *
+ *  @param uart The UART instance.
+ *  @param registers The UART module.
+ *  @return bool - TRUE if any bytes were written.
+ */
+static inline bool TransmitBytes(TUART * const uart, const UART_MemMapPtr registers)
+{
+  uint8_t txData;
+  bool sent = false;
+#ifdef UART_HARDWARE_FIFO
+  uint8_t nbFree = uart->TxFIFODepth - UART_TCFIFO_REG(registers);
+#else
+  uint8_t nbFree = 1;
+#endif
+
+  while (nbFree > 0 && GetTxByte(uart, &txData))
+  {
+    // Write to UART data register
+    UART_D_REG(registers) = txData;
+    nbFree--;
+    sent = true;
+    uart->Statistics.NbTxBytes++;
+  }
+
+  return sent;
+}
+
+/*! @brief Service the RX/TX interrupt of a UART instance.
+ *
+ *  Each instance's ISR calls this with its own constant configuration,
+ *  so the register addresses and DMA choices are resolved at compile time.
+ *
+ *  @param uart The UART instance.
+ *  @param config The hardware resources of the instance.
+ */
+static inline void ServiceInterrupt(TUART * const uart, const TUARTConfig * const config)
+{
+#ifdef UART_ISR_CYCLES
+  const uint32_t startCycles = DWT_CYCCNT;
+#endif
+  const UART_MemMapPtr registers = config->Registers;
+
+  // Reading the status register is also the first step in clearing the IDLE, OR, NF, FE, PF and TC flags
+  const uint8_t status = UART_S1_REG(registers);
+
+  // A received byte was lost because the receiver was not serviced in time
+  if (status & UART_S1_OR_MASK)
+    uart->Statistics.NbOverruns++;
+
+  // The errors of a received byte, whose flags are cleared by reading it (or the next byte) from the data register
+  if (status & UART_S1_NF_MASK)
+    uart->Statistics.NbNoiseErrors++;
+  if (status & UART_S1_FE_MASK)
+    uart->Statistics.NbFramingErrors++;
+  if (status & UART_S1_PF_MASK)
+    uart->Statistics.NbParityErrors++;
+
+#ifdef UART_HARDWARE_FIFO
+  const uint8_t fifoStatus = UART_SFIFO_REG(registers);
+
+  if (fifoStatus & UART_SFIFO_RXUF_MASK)
+    uart->Statistics.NbRxUnderflows++;
+  if (fifoStatus & UART_SFIFO_TXOF_MASK)
+    uart->Statistics.NbTxOverflows++;
+
+  UART_SFIFO_REG(registers) = fifoStatus & (UART_SFIFO_RXUF_MASK | UART_SFIFO_TXOF_MASK);
+#endif
+
+  if (UsesRxDMA(config))
+  {
+    // Received bytes are written into the receive FIFO buffer by DMA, and collected once the line goes idle
+    if (status & UART_S1_IDLE_MASK)
     {
-      // Disable Transmit Empty Interrupts
-      UART2_C2 &= ~UART_C2_TIE_MASK;
+      // Once another byte has arrived, reading it would steal it from the DMA channel,
+      // whose own read of the data register completes clearing the IDLE flag instead
+      if (!(UART_S1_REG(registers) & UART_S1_RDRF_MASK))
+        ClearIdle(registers);
+      PublishRxDMA(uart);
     }
   }
+  // Check if data ready to read from the UART, or left below the receive watermark when the line went idle
+  else if (((UART_C2_REG(registers) & UART_C2_RIE_MASK) && (status & UART_S1_RDRF_MASK)) || (status & UART_S1_IDLE_MASK))
+  {
+    // Read from the UART data register into the receive FIFO buffer
+    if (!ReceiveBytes(uart, registers, status))
+      ClearIdle(registers);
+
+    if (UsesFlowControl(config))
+      CheckRTSOff(uart);
+  }
+
+  // Check if the receive line has gone idle after a burst of data
+  if ((UART_C2_REG(registers) & UART_C2_ILIE_MASK) && (status & UART_S1_IDLE_MASK))
+  {
+    // Wake the receiver for whatever has arrived, even if it is below the wake threshold
+    RxFIFO_Flush(&uart->RxFIFO);
+  }
 
+  if (UsesTxDMA(config))
+  {
+    // Check if the UART has finished transmitting the previous message
+    if ((UART_C2_REG(registers) & UART_C2_TCIE_MASK) && (status & UART_S1_TC_MASK))
+      ServiceTxDMA(uart, config);
+  }
+  // Check if the UART is ready to transmit and there is data waiting in transmit FIFO buffer
+  else if ((UART_C2_REG(registers) & UART_C2_TIE_MASK) && (status & UART_S1_TDRE_MASK))
+  {
+    // Disable Transmit Empty Interrupts once there is nothing left to send
+    if (!TransmitBytes(uart, registers))
+      UART_C2_REG(registers) &= ~UART_C2_TIE_MASK;
+  }
+
+#ifdef UART_ISR_CYCLES
+  const uint32_t nbCycles = DWT_CYCCNT - startCycles;
+
+  uart->Statistics.NbInterrupts++;
+  uart->Statistics.TotalISRCycles += nbCycles;
+  if (nbCycles < uart->Statistics.MinISRCycles)
+    uart->Statistics.MinISRCycles = nbCycles;
+  if (nbCycles > uart->Statistics.MaxISRCycles)
+    uart->Statistics.MaxISRCycles = nbCycles;
+#endif
+}
+
+#ifdef UART_USE_UART0
+void __attribute__ ((interrupt)) UART0_ISR(void)
+{
+  OS_ISREnter();
+  ServiceInterrupt(&UART_Port0, &UART0Config);
+  OS_ISRExit();
+}
+#endif
+
+#ifdef UART_USE_UART1
+void __attribute__ ((interrupt)) UART1_ISR(void)
+{
+  OS_ISREnter();
+  ServiceInterrupt(&UART_Port1, &UART1Config);
+  OS_ISRExit();
+}
+#endif
+
+#ifdef UART_USE_UART2
+void __attribute__ ((interrupt)) UART_ISR(void)
+{
+  OS_ISREnter();
+  ServiceInterrupt(&UART_Port2, &UART2Config);
+  OS_ISRExit();
+}
+
+void __attribute__ ((interrupt)) UART_RxDMA_ISR(void)
+{
+  OS_ISREnter();
+
+  // Clear the half or major loop interrupt, then make what the channel has written available to the receiver
+  DMA_CINT = DMA_CINT_CINT(UART2Config.RxDMAChannel);
+  PublishRxDMA(&UART_Port2);
+
+  OS_ISRExit();
+}
+#endif
+
+#ifdef UART_USE_UART3
+void __attribute__ ((interrupt)) UART3_ISR(void)
+{
+  OS_ISREnter();
+  ServiceInterrupt(&UART_Port3, &UART3Config);
+  OS_ISRExit();
+}
+#endif
+
+#ifdef UART_USE_UART4
+void __attribute__ ((interrupt)) UART4_ISR(void)
+{
+  OS_ISREnter();
+  ServiceInterrupt(&UART_Port4, &UART4Config);
+  OS_ISRExit();
+}
+#endif
+
+#ifdef UART_USE_UART5
+void __attribute__ ((interrupt)) UART5_ISR(void)
+{
+  OS_ISREnter();
+  ServiceInterrupt(&UART_Port5, &UART5Config);
   OS_ISRExit();
 }
+#endif
 
 /*!
  * @}
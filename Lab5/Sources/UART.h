@@ -13,34 +13,290 @@
 
 // new types
 #include "types.h"
+#include "FIFO.h"
+
+// The UART modules the driver is built for. Commenting one out removes its buffers, configuration and ISR
+//#define UART_USE_UART0
+//#define UART_USE_UART1
+#define UART_USE_UART2
+//#define UART_USE_UART3
+//#define UART_USE_UART4
+//#define UART_USE_UART5
+
+/*!
+ * @struct TUART
+ *
+ * A UART instance, with its own transmit and receive FIFOs, statistics and baud rate.
+ * Every UART function takes the instance it works on, e.g. &UART_Port2.
+ */
+typedef struct UARTInstance TUART;
+
+#ifdef UART_USE_UART0
+extern TUART UART_Port0; /*!< UART0, TX = PTD7, RX = PTD6, clocked by the system clock */
+#endif
+#ifdef UART_USE_UART1
+extern TUART UART_Port1; /*!< UART1, TX = PTE0, RX = PTE1, clocked by the system clock */
+#endif
+#ifdef UART_USE_UART2
+extern TUART UART_Port2; /*!< UART2, TX = PTE16, RX = PTE17, clocked by the bus clock */
+#endif
+#ifdef UART_USE_UART3
+extern TUART UART_Port3; /*!< UART3, TX = PTC17, RX = PTC16, clocked by the bus clock */
+#endif
+#ifdef UART_USE_UART4
+extern TUART UART_Port4; /*!< UART4, TX = PTE24, RX = PTE25, clocked by the bus clock */
+#endif
+#ifdef UART_USE_UART5
+extern TUART UART_Port5; /*!< UART5, TX = PTE8, RX = PTE9, clocked by the bus clock */
+#endif
+
+/*!
+ * @enum TUARTTxClass
+ *
+ * The transmit priority classes, highest priority first.
+ * Each class has its own transmit FIFO, and a message of a higher class is always sent before one of a lower class.
+ */
+typedef enum
+{
+  UART_TX_CONTROL,    /*!< Command responses and acknowledgements */
+  UART_TX_TIME,       /*!< Time updates */
+  UART_TX_TELEMETRY,  /*!< Periodic data such as analog values, by default dropping the oldest when full */
+  UART_NB_TX_CLASSES  /*!< The number of transmit classes */
+} TUARTTxClass;
+
+/*!
+ * @struct TUARTStatistics
+ *
+ * Link statistics of a UART: throughput, the error conditions it flagged, and the time spent in its ISR.
+ */
+typedef struct
+{
+  uint32_t NbRxBytes;       /*!< Bytes received, including any dropped because the receive FIFO was full */
+  uint32_t NbTxBytes;       /*!< Bytes handed to the transmitter */
+  uint32_t NbOverruns;      /*!< Received bytes lost because the receiver was not serviced in time */
+  uint32_t NbNoiseErrors;   /*!< Received bytes with noise detected on the line */
+  uint32_t NbFramingErrors; /*!< Received bytes without a valid stop bit */
+  uint32_t NbParityErrors;  /*!< Received bytes with the wrong parity (parity is disabled, so these should not occur) */
+  uint32_t NbRxUnderflows;  /*!< Unexpected reads of an empty hardware receive FIFO */
+  uint32_t NbTxOverflows;   /*!< Writes to a full hardware transmit FIFO */
+  uint32_t NbInterrupts;    /*!< Interrupts serviced and timed for the cycle counts below, 0 if the ISR timing is compiled out */
+  uint32_t MinISRCycles;    /*!< Fewest CPU cycles spent servicing an interrupt, 0 until one has been timed */
+  uint32_t MaxISRCycles;    /*!< Most CPU cycles spent servicing an interrupt */
+  uint64_t TotalISRCycles;  /*!< CPU cycles spent servicing all the interrupts, so the average is TotalISRCycles / NbInterrupts */
+} TUARTStatistics;
+
+/*!
+ * @struct TUARTBaudRate
+ *
+ * The baud rate generator settings for a baud rate, and how close they come to it.
+ */
+typedef struct
+{
+  uint32_t BaudRate;          /*!< The requested baud rate in bits/sec */
+  uint32_t AchievedBaudRate;  /*!< The baud rate the divisor actually produces in bits/sec */
+  int32_t ErrorPPM;           /*!< The error of the achieved baud rate, in parts per million of the requested one */
+  uint16_t SBR;               /*!< The 13-bit baud rate modulo divisor */
+  uint8_t BRFA;               /*!< The 5-bit fine adjust, in 32nds of the divisor */
+} TUARTBaudRate;
+
+/*! @brief Calculate the closest baud rate generator settings for a baud rate.
+ *
+ *  The highest baud rate is moduleClk / 16, e.g. 1562500 for the 25 MHz bus clock that drives UART2.
+ *
+ *  @param baudRate The desired baud rate in bits/sec.
+ *  @param moduleClk The module clock rate in Hz.
+ *  @param settingsPtr A pointer to store the settings, and the achieved baud rate and its error.
+ *  @return bool - TRUE if the baud rate can be generated with an error of 2% or less.
+ */
+bool UART_CalculateBaudRate(const uint32_t baudRate, const uint32_t moduleClk, TUARTBaudRate* const settingsPtr);
 
 /*! @brief Sets up the UART interface before first use.
  *
+ *  @param uart The UART instance.
  *  @param baudRate The desired baud rate in bits/sec.
  *  @param moduleClk The module clock rate in Hz.
  *  @return bool - TRUE if the UART was successfully initialized.
  */
-bool UART_Init(const uint32_t baudRate, const uint32_t moduleClk);
+bool UART_Init(TUART* const uart, const uint32_t baudRate, const uint32_t moduleClk);
  
 /*! @brief Get a character from the receive FIFO. Blocks until it is not empty
  *
+ *  @param uart The UART instance.
  *  @param dataPtr A pointer to memory to store the retrieved byte.
- *  @note Assumes that UART_Init has been called.
+ *  @note Assumes that UART_Init has been called for the instance.
  */
-void UART_InChar(uint8_t* const dataPtr);
+void UART_InChar(TUART* const uart, uint8_t* const dataPtr);
 
-/*! @brief Put a byte in the transmit FIFO if it is not full.
+/*! @brief Put a byte in the control transmit FIFO. Blocks until there is room.
  *
+ *  @param uart The UART instance.
  *  @param data The byte to be placed in the transmit FIFO.
  *  @return bool - TRUE if the data was placed in the transmit FIFO.
- *  @note Assumes that UART_Init has been called.
+ *  @note Assumes that UART_Init has been called for the instance.
+ */
+bool UART_OutChar(TUART* const uart, const uint8_t data);
+
+/*! @brief Get several characters from the receive FIFO. Blocks until all of them have been received.
+ *
+ *  @param uart The UART instance.
+ *  @param dataPtr A pointer to memory to store the retrieved bytes.
+ *  @param nbBytes The number of bytes to retrieve.
+ *  @note Assumes that UART_Init has been called for the instance.
+ */
+void UART_InChars(TUART* const uart, uint8_t* const dataPtr, const uint16_t nbBytes);
+
+/*! @brief Put several bytes in the control transmit FIFO. Blocks until all of them have been placed.
+ *
+ *  Only each FIFO_SLOT_SIZE bytes are guaranteed not to be interleaved with data from other threads.
+ *
+ *  @param uart The UART instance.
+ *  @param dataPtr A pointer to the bytes to be placed in the transmit FIFO.
+ *  @param nbBytes The number of bytes to place.
+ *  @return bool - TRUE if the data was placed in the transmit FIFO.
+ *  @note Assumes that UART_Init has been called for the instance.
+ */
+bool UART_OutChars(TUART* const uart, const uint8_t* const dataPtr, const uint16_t nbBytes);
+
+/*! @brief Look at the oldest received bytes in place. Blocks until they have all been received.
+ *
+ *  @param uart The UART instance.
+ *  @param nbBytes The number of bytes to examine, no greater than FIFO_WINDOW_SIZE.
+ *  @return const uint8_t* - A pointer to nbBytes contiguous received bytes.
+ *  @note The bytes remain valid until they are released with UART_InConsume.
+ *  @note Assumes that UART_Init has been called for the instance.
  */
-bool UART_OutChar(const uint8_t data);
+const uint8_t* UART_InPeek(TUART* const uart, const uint16_t nbBytes);
 
-/*! @brief Interrupt service routine for the UART.
+/*! @brief Discard received bytes that have been examined with UART_InPeek.
  *
- *  @note Assumes the transmit and receive FIFOs have been initialized.
+ *  @param uart The UART instance.
+ *  @param nbBytes The number of bytes to discard.
+ *  @note Assumes that UART_Init has been called for the instance.
  */
+void UART_InConsume(TUART* const uart, const uint16_t nbBytes);
+
+/*! @brief The number of received bytes waiting to be read.
+ *
+ *  @param uart The UART instance.
+ *  @return uint16_t - The number of bytes that can be read without blocking.
+ *  @note Assumes that UART_Init has been called for the instance.
+ */
+uint16_t UART_InNbBytes(TUART* const uart);
+
+/*! @brief Reserve a slot in the transmit FIFO to build a message in place. Blocks until there is room, or the timeout expires.
+ *
+ *  Any number of threads may reserve and commit at once, and their messages are never interleaved.
+ *  If the class drops the oldest message when full, this only waits if that message is already being transmitted.
+ *
+ *  @param uart The UART instance.
+ *  @param txClass The transmit priority class of the message.
+ *  @param timeout The maximum number of OS ticks to wait for room, 0 to wait forever.
+ *  @return uint8_t* - A pointer to FIFO_SLOT_SIZE bytes to write, or NULL if the timeout expired.
+ *  @note Assumes that UART_Init has been called for the instance.
+ */
+uint8_t* UART_OutReserve(TUART* const uart, const TUARTTxClass txClass, const uint32_t timeout);
+
+/*! @brief Transmit a message built in place after UART_OutReserve.
+ *
+ *  @param uart The UART instance.
+ *  @param txClass The transmit priority class the message was reserved in.
+ *  @param dataPtr The pointer returned by UART_OutReserve.
+ *  @param nbBytes The number of bytes to transmit, no greater than FIFO_SLOT_SIZE.
+ *  @note Assumes that UART_Init has been called for the instance.
+ */
+void UART_OutCommit(TUART* const uart, const TUARTTxClass txClass, uint8_t* const dataPtr, const uint8_t nbBytes);
+
+/*! @brief Choose whether a full transmit class drops its oldest message or makes senders wait.
+ *
+ *  @param uart The UART instance.
+ *  @param txClass The transmit priority class.
+ *  @param dropOldest TRUE to drop the oldest message not yet being transmitted, FALSE to wait for room.
+ *  @note Assumes that UART_Init has been called for the instance.
+ */
+void UART_SetDropOldest(TUART* const uart, const TUARTTxClass txClass, const bool dropOldest);
+
+/*! @brief Sets how many bytes must be received before a thread blocked on receiving is woken.
+ *
+ *  A blocked thread is also woken with fewer bytes when the receive line goes idle.
+ *
+ *  @param uart The UART instance.
+ *  @param nbBytes The number of bytes to accumulate before waking, 1 wakes on every byte.
+ *  @note Assumes that UART_Init has been called for the instance.
+ */
+void UART_SetReceiveThreshold(TUART* const uart, const uint16_t nbBytes);
+
+/*! @brief Take a snapshot of the statistics of a transmit class FIFO.
+ *
+ *  @param uart The UART instance.
+ *  @param txClass The transmit priority class.
+ *  @param statisticsPtr A pointer to store the statistics, counted in messages.
+ *  @return bool - TRUE if FIFO statistics are enabled.
+ *  @note Assumes that UART_Init has been called for the instance.
+ */
+bool UART_GetTxStatistics(TUART* const uart, const TUARTTxClass txClass, TFIFOStatistics* const statisticsPtr);
+
+/*! @brief Take a snapshot of the receive FIFO statistics.
+ *
+ *  @param uart The UART instance.
+ *  @param statisticsPtr A pointer to store the statistics, counted in bytes.
+ *  @return bool - TRUE if FIFO statistics are enabled.
+ *  @note Assumes that UART_Init has been called for the instance.
+ */
+bool UART_GetRxStatistics(TUART* const uart, TFIFOStatistics* const statisticsPtr);
+
+/*! @brief Change the baud rate.
+ *
+ *  Waits (for a bounded time) for the messages already queued to be sent at the old baud rate first.
+ *
+ *  @param uart The UART instance.
+ *  @param baudRate The desired baud rate in bits/sec.
+ *  @return bool - TRUE if the baud rate could be generated, and was changed.
+ *  @note Assumes that UART_Init has been called for the instance.
+ */
+bool UART_SetBaudRate(TUART* const uart, const uint32_t baudRate);
+
+/*! @brief Get the baud rate the UART is running at.
+ *
+ *  @param uart The UART instance.
+ *  @param settingsPtr A pointer to store the baud rate generator settings.
+ *  @note Assumes that UART_Init has been called for the instance.
+ */
+void UART_GetBaudRate(TUART* const uart, TUARTBaudRate* const settingsPtr);
+
+/*! @brief Take a consistent snapshot of the UART link statistics.
+ *
+ *  @param uart The UART instance.
+ *  @param statisticsPtr A pointer to store the statistics.
+ *  @note Assumes that UART_Init has been called for the instance.
+ */
+void UART_GetStatistics(TUART* const uart, TUARTStatistics* const statisticsPtr);
+
+/*! @brief Interrupt service routines for the UART instances.
+ *
+ *  UART_ISR services UART2, and is the one Processor Expert places in the vector table.
+ *  The others must be placed on their UARTn_RX_TX vectors when their instances are used.
+ *  UART_RxDMA_ISR services the UART2 receive DMA channel, on the DMA1_DMA17 vector.
+ *
+ *  @note Assumes the transmit and receive FIFOs of the instance have been initialized.
+ */
+#ifdef UART_USE_UART0
+void __attribute__ ((interrupt)) UART0_ISR(void);
+#endif
+#ifdef UART_USE_UART1
+void __attribute__ ((interrupt)) UART1_ISR(void);
+#endif
+#ifdef UART_USE_UART2
 void __attribute__ ((interrupt)) UART_ISR(void);
+void __attribute__ ((interrupt)) UART_RxDMA_ISR(void);
+#endif
+#ifdef UART_USE_UART3
+void __attribute__ ((interrupt)) UART3_ISR(void);
+#endif
+#ifdef UART_USE_UART4
+void __attribute__ ((interrupt)) UART4_ISR(void);
+#endif
+#ifdef UART_USE_UART5
+void __attribute__ ((interrupt)) UART5_ISR(void);
+#endif
 
 #endif
@@ -57,7 +57,7 @@ bool Analog_Init(const uint32_t moduleClock)
   return SPI_Init(&spiModule, moduleClock);
 }
 
-bool Analog_Get(const uint8_t channelNb)
+bool Analog_Sample(const uint8_t channelNb, int16_t * const valuePtr)
 {
   // Select the ADC device
   SPI_SelectSlaveDevice(ADC_SLAVE_ADDR);
@@ -66,8 +66,6 @@ bool Analog_Get(const uint8_t channelNb)
   if (channelNb >= ANALOG_NB_INPUTS)
     return false;
 
-  TAnalogInput *input = &Analog_Input[channelNb];
-
   // Create ADC Command for switching mode
   uint16_t command =
                   (ADC_SGL_MASK | //Single sided diff - Not comparison
@@ -77,19 +75,88 @@ bool Analog_Get(const uint8_t channelNb)
   SPI_ExchangeChar(command, NULL);
   WaitForConversion();
 
-  SPI_ExchangeChar(0, input->putPtr); // Read analog signal into current position
+  SPI_ExchangeChar(0, (uint16_t *) valuePtr); // Read analog signal
   WaitForConversion();
 
+  return true;
+}
+
+void Analog_Put(const uint8_t channelNb, const int16_t value)
+{
+  TAnalogInput *input = &Analog_Input[channelNb];
+
+  // Store the value in the current position
+  *input->putPtr = value;
+
   // Increment the pointer, and loop back to start if needed.
   // Since we're running a median filter over the results we can use it as a
   // circular buffer
   input->putPtr++;
   if (input->putPtr == &input->values[ANALOG_WINDOW_SIZE])
     input->putPtr = &input->values[0];
+}
+
+bool Analog_Get(const uint8_t channelNb)
+{
+  int16_t value;
+
+  if (!Analog_Sample(channelNb, &value))
+    return false;
+
+  Analog_Put(channelNb, value);
+  return true;
+}
+
+void Analog_SendValue(TPacketLink* const link, const uint8_t channelNb, const int16union_t value)
+{
+  (void) Packet_PutPriority(link, UART_TX_TELEMETRY, ANALOG_COMMAND_VALUE, channelNb, value.s.Lo, value.s.Hi);
+}
+
+void Analog_SendFrame(TPacketLink* const link, const uint8_t sequenceNb, const uint8_t nbSamples, const int16union_t samples[])
+{
+  uint8_t payload[PACKET_FRAME_MAX_PAYLOAD];
+  uint8_t nbBytes = 0;
+
+  payload[nbBytes++] = ANALOG_NB_INPUTS;
+  payload[nbBytes++] = nbSamples;
+  payload[nbBytes++] = sequenceNb;
+
+  for (uint8_t i = 0; i < nbSamples * ANALOG_NB_INPUTS; i++)
+  {
+    payload[nbBytes++] = samples[i].s.Lo;
+    payload[nbBytes++] = samples[i].s.Hi;
+  }
+
+  (void) Packet_PutFrame(link, UART_TX_TELEMETRY, ANALOG_COMMAND_FRAME, payload, nbBytes);
+}
 
+/*! @brief Handles the "Analog Input - Value" packet
+ *
+ * Command: 0x50
+ * Parameter 1: Channel Nb (0-7) (currently only 0 & 1 are implemented)
+ * Parameter 2: 0
+ * Parameter 3: 0
+ *
+ * Response: "Analog Input - Value" packet with the current value of the channel
+ *
+ *  @param link The link the packet was received on.
+ *  @param packet The received packet.
+ *  @return bool - TRUE if the packet was successfully handled.
+ */
+static bool HandleValue(TPacketLink* const link, const TPacket* const packet)
+{
+  if (Packet_Parameter1(packet) >= ANALOG_NB_INPUTS)
+    return false;
+
+  Analog_SendValue(link, Packet_Parameter1(packet), Analog_Input[Packet_Parameter1(packet)].value);
   return true;
 }
 
+bool Analog_RegisterCommands(TPacketLink* const link)
+{
+  return Packet_Register(link, ANALOG_COMMAND_VALUE, HandleValue, PACKET_PARAMETER2_ZERO | PACKET_PARAMETER3_ZERO);
+}
+
 /*!
  * @}
  */
@@ -13,12 +13,23 @@
 
 // new types
 #include "types.h"
+#include "packet.h"
 
 // Maximum number of channels
 #define ANALOG_NB_INPUTS 2
 
 #define ANALOG_WINDOW_SIZE 5
 
+// Tower commands implemented by the analog module
+#define ANALOG_COMMAND_VALUE 0x50 // "Analog Input - Value" Command
+#define ANALOG_COMMAND_FRAME 0x51 // "Analog Input - Frame" Command
+
+// Number of bytes in an "Analog Input - Frame" payload before the samples
+#define ANALOG_FRAME_HEADER_SIZE 3
+
+// Largest number of samples of each channel in one "Analog Input - Frame", so that the whole frame fits in one transmit slot
+#define ANALOG_FRAME_MAX_NB_SAMPLES ((PACKET_FRAME_MAX_PAYLOAD - ANALOG_FRAME_HEADER_SIZE) / (2 * ANALOG_NB_INPUTS))
+
 #pragma pack(push)
 #pragma pack(2)
 
@@ -48,4 +59,62 @@ bool Analog_Init(const uint32_t moduleClock);
  */
 bool Analog_Get(const uint8_t channelNb);
 
+/*! @brief Takes a sample from an analog input channel, without adding it to the sliding window.
+ *
+ *  @param channelNb is the number of the analog input channel to sample. 0 or 1.
+ *  @param valuePtr A pointer to store the sampled value.
+ *  @return bool - true if the channel was read successfully.
+ */
+bool Analog_Sample(const uint8_t channelNb, int16_t* const valuePtr);
+
+/*! @brief Adds a sample to an analog input channel's sliding window.
+ *
+ *  @param channelNb is the number of the analog input channel. 0 or 1.
+ *  @param value The sampled value.
+ */
+void Analog_Put(const uint8_t channelNb, const int16_t value);
+
+/*! @brief Sends the "Analog Input - Value" packet.
+ *
+ * Command: 0x50
+ * Parameter 1: Channel Nb (0-7) (currently only 0 & 1 are implemented)
+ * Parameter 2: LSB
+ * Parameter 3: MSB
+ *
+ *  @param link The link to send on.
+ *  @param channelNb The number of the analog input channel.
+ *  @param value The value of the channel.
+ */
+void Analog_SendValue(TPacketLink* const link, const uint8_t channelNb, const int16union_t value);
+
+/*! @brief Sends an "Analog Input - Frame" frame.
+ *
+ * Command: 0x51
+ * Byte 1: Number of channels, M
+ * Byte 2: Number of samples of each channel, N
+ * Byte 3: Sequence number, incremented for every frame so the PC can tell when frames have been dropped
+ * Bytes 4 to 3 + 2 * M * N: The samples oldest first, each sample holding every channel in order, LSB first
+ * Last byte: Checksum, every preceding byte XORed together
+ *   or, if PACKET_CRC is defined,
+ * Last 2 bytes: CRC-16 of every preceding byte, LSB first
+ *
+ * So with the two channels and N = 6 a frame carries 12 values in 29 bytes, rather than 60 bytes of "Analog Input - Value"
+ * packets (30 rather than 72 with PACKET_CRC), before any COBS encoding. Host/PCDecoder.c decodes frames on the PC.
+ *
+ *  @param link The link to send on.
+ *  @param sequenceNb The sequence number of the frame.
+ *  @param nbSamples The number of samples of each channel, no greater than ANALOG_FRAME_MAX_NB_SAMPLES.
+ *  @param samples The samples, nbSamples of each channel in the same order as on the wire.
+ */
+void Analog_SendFrame(TPacketLink* const link, const uint8_t sequenceNb, const uint8_t nbSamples, const int16union_t samples[]);
+
+/*! @brief Registers the handler of the "Analog Input - Value" command on a link.
+ *
+ *  The PC may send it to get the current value of a channel, rather than waiting for the next one to be sent.
+ *
+ *  @param link The link to receive the command on.
+ *  @return bool - TRUE if the command was registered.
+ */
+bool Analog_RegisterCommands(TPacketLink* const link);
+
 #endif
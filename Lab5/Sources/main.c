@@ -26,12 +26,14 @@
 #include "INT_FTM0.h"
 #include "INT_PendableSrvReq.h"
 #include "INT_SysTick.h"
+#include "INT_DMA1_DMA17.h"
 #include "PE_Types.h"
 #include "PE_Error.h"
 #include "PE_Const.h"
 #include "IO_Map.h"
 #include "types.h"
 #include "Packet.h"
+#include "UART.h"
 #include "LEDs.h"
 #include "Flash.h"
 #include "RTC.h"
@@ -39,28 +41,67 @@
 #include "FTM.h"
 #include "analog.h"
 #include "median.h"
+#include "FIFO.h"
 #include "OS.h"
+#include "CRC.h"
 
 #define THREAD_STACK_SIZE 200
 
+// Number of analog samples that can be waiting to be processed, per channel
+#define ANALOG_FIFO_SIZE 8
+
+// Largest number of sequenced packets the PC may have in flight, so that a whole window of them
+// (7 bytes each with a CRC, and COBS adds 2) fits in the UART receive buffer
+#define PROTOCOL_MAX_WINDOW_SIZE 16
+
 // Commenting the below out disables analog packets in async mode
 //#define TRANSMIT_ASYNC_PACKETS
 
+// Uncommenting the below times the hardware and software CRCs at startup, with the results (CRCBenchmark) read with the debugger
+//#define CRC_BENCHMARK
+
+// Number of bytes the CRC benchmark checks
+#define CRC_BENCHMARK_NB_BYTES 256
+
 const uint8_t PACKET_ACK_MASK = 1 << 7; // Command ID has bit 7 (MSB) reserved for packet acknowledgement
 const uint32_t BAUD_RATE = 115200; // Either 38400 or 115200 baud. Default is 38400.
+TUART* const TOWER_UART = &UART_Port2; // The UART the Tower protocol runs on
+static TPacketLink TowerLink; // The Tower protocol instance on TOWER_UART
 
-// Enum for Tower Command Packet opcodes
+// Enum for Tower Command Packet opcodes, those of the packet, Flash, RTC and analog modules are in their headers
 enum TowerCommand
 {
   STARTUP = 0x04, // "Tower Startup" / "Get startup values" Command
-  FLASH_PROG = 0x07, // "Flash - Program Byte" Command
-  FLASH_READ = 0x08, // "Flash - Read Byte" Command
   SPECIAL = 0x09, // "Special - Tower version" / "Special -  Get startup values" Command
   TOWER_NUMBER = 0x0B, // "Tower Number" Command
-  TIME = 0x0C, // "Time" Command
   TOWER_MODE = 0x0D, // "Tower Mode" Command
   PROTOCOL_MODE = 0x0A, // "Protocol - Mode" Command
-  ANALOG_INPUT = 0x50, // "Analog Input - Value" Command
+  FIFO_STATISTICS = 0x30, // "FIFO - Statistics" Command
+  UART_BAUD_RATE = 0x31, // "UART - Baud Rate" Command
+  PROTOCOL_ACKNOWLEDGE = 0x33, // "Protocol - Acknowledge" Command, the cumulative acknowledgement of sequenced packets
+};
+
+// Enum for the FIFOs reported by the "FIFO - Statistics" Command
+enum FIFONumber
+{
+  FIFO_UART_TX_CONTROL = 0, // UART control transmit FIFO
+  FIFO_UART_RX = 1, // UART receive FIFO
+  FIFO_ANALOG = 2, // Analog sample FIFO for channel 0, followed by the other channels
+  FIFO_UART_TX_TIME = 14, // UART time transmit FIFO
+  FIFO_UART_TX_TELEMETRY = 15, // UART telemetry transmit FIFO
+};
+
+// Enum for the statistics reported by the "FIFO - Statistics" Command
+// 32-bit statistics are sent as two values, the low half first
+enum FIFOStatistic
+{
+  FIFO_STATISTIC_NB_ELEMENTS = 0, // Current number of elements
+  FIFO_STATISTIC_PEAK_NB_ELEMENTS = 1, // Largest number of elements
+  FIFO_STATISTIC_NB_PUT = 2, // Total elements put (2 = low, 3 = high)
+  FIFO_STATISTIC_NB_GET = 4, // Total elements got (4 = low, 5 = high)
+  FIFO_STATISTIC_NB_DROPPED = 6, // Total elements dropped (6 = low, 7 = high)
+  FIFO_STATISTIC_PUT_BLOCKED_TICKS = 8, // Total OS ticks producers were blocked (8 = low, 9 = high)
+  FIFO_STATISTIC_GET_BLOCKED_TICKS = 10, // Total OS ticks consumers were blocked (10 = low, 11 = high)
 };
 
 // Enum for Tower Protocol Mode
@@ -68,19 +109,44 @@ typedef enum
 {
   ASYNCHRONOUS = 0, /*! Asynchronous protocol mode */
   SYNCHRONOUS = 1, /*! Synchronous protocol mode */
+  FRAMED = 2, /*! Synchronous protocol mode, with the analog values batched into frames */
 } ProtocolMode;
 
+// An analog sample or value, stamped with the PIT tick it was sampled on
+typedef struct
+{
+  uint32_t Tick; /*! The PIT tick, the same for every channel sampled together */
+  int16_t Value; /*! The sample, or the filtered value */
+} TAnalogSample;
+
+// FIFO of analog samples, from the PIT to the analog processing threads
+FIFO_DEFINE(AnalogFIFO, TAnalogSample, ANALOG_FIFO_SIZE, 0)
+
 // Struct for the analog processing thead
 typedef struct
 {
   uint8_t ChannelNb; /*! Channel Number */
-  OS_ECB* Semaphore; /*! Semaphore for the analog processing thread */
+  TAnalogFIFO Samples; /*! Samples taken by the PIT, waiting for the analog processing thread */
   TAnalogInput* Values;  /*! Analog values */
+  TAnalogFIFO FrameValues; /*! Values waiting for the analog frame thread, in framed mode */
 } TAnalogThread;
 
 static volatile uint16union_t * NvTowerNb; /*! The Tower's Number */
 static volatile uint16union_t * NvTowerMode; /*! The Tower's Mode */
 static ProtocolMode TowerProtocolMode; /* The Tower's Protocol Mode */
+static uint8_t AnalogFrameNbSamples = ANALOG_FRAME_MAX_NB_SAMPLES; /* Samples of each channel per analog frame, in framed mode */
+static volatile uint32_t AnalogTick; /*! PIT ticks the analog channels have been sampled on */
+static volatile uint32_t AnalogFramedTick; /*! The PIT tick framed mode was last entered on, earlier values are not framed */
+static uint32_t PendingBaudRate; /*! The baud rate to switch to once the "UART - Baud Rate" command is acknowledged, 0 if none */
+static bool TransportPending; /*! TRUE if PendingTransport is to be switched to once the "Protocol - Mode" command is acknowledged */
+static TPacketTransport PendingTransport; /*! The packet transport to switch to */
+static bool WindowPending; /*! TRUE if PendingWindowSize is to be switched to once the "Protocol - Mode" command is acknowledged */
+static uint8_t PendingWindowSize; /*! The acknowledgement window size to switch to */
+static uint8_t WindowSize; /*! Sequenced packets the PC may have in flight, 0 for stop-and-wait acknowledgement */
+static uint8_t NextSequenceNb; /*! The sequence number of the next packet to handle, every earlier one has been */
+static uint8_t NbUnacknowledged; /*! Packets handled since the last "Protocol - Acknowledge" */
+static uint8_t LastFailedSequenceNb; /*! The sequence number of the last packet that failed */
+static uint8_t NbFailed; /*! Sequenced packets that have failed, modulo 256 */
 
 static uint32_t ProtocolProcessingThreadStack[THREAD_STACK_SIZE] __attribute__ ((aligned(0x08))); /*! The stack for the protocol responses. */
 static uint32_t RTCThreadStack[THREAD_STACK_SIZE] __attribute__ ((aligned(0x08))); /*! The stack for the RTC thread. */
@@ -88,11 +154,17 @@ static uint32_t FTMThreadStack[THREAD_STACK_SIZE] __attribute__ ((aligned(0x08))
 
 static TAnalogThread AnalogProcessingThreadSettings[ANALOG_NB_INPUTS]; /*! The settings for the Analog Processing threads */
 static uint32_t AnalogProcessingThreadStack[THREAD_STACK_SIZE * ANALOG_NB_INPUTS] __attribute__ ((aligned(0x08))); /*! The stack for the processing of analog data. */
+static uint32_t AnalogFrameThreadStack[THREAD_STACK_SIZE] __attribute__ ((aligned(0x08))); /*! The stack for the analog frames. */
 
 static TFTMChannel LedTimerChannel; /*! The timer channel + settings for the FTM */
 
 static OS_ECB* RTCSemaphore; /*! The semaphore for the RTC to signal */
 
+#ifdef CRC_BENCHMARK
+static TCRCBenchmark CRCBenchmark; /*! The cycles taken by each way of calculating a CRC */
+static bool CRCBenchmarkAgreed; /*! TRUE if the hardware and software CRCs agreed */
+#endif
+
 /*! @brief Send the "Tower Startup" packet
  *
  * Command: 0x04
@@ -106,7 +178,7 @@ static OS_ECB* RTCSemaphore; /*! The semaphore for the RTC to signal */
  */
 static void SendStartup(void)
 {
-  (void) Packet_Put(STARTUP, 0, 0, 0);
+  (void) Packet_Put(&TowerLink, STARTUP, 0, 0, 0);
 }
 
 /*! @brief Send the "Tower version" response packet
@@ -122,7 +194,7 @@ static void SendStartup(void)
  */
 static void SendVersion(void)
 {
-  (void) Packet_Put(SPECIAL, 'v', 5, 0);
+  (void) Packet_Put(&TowerLink, SPECIAL, 'v', 5, 0);
 }
 
 /*! @brief Send the "Tower number" response packet
@@ -135,7 +207,7 @@ static void SendVersion(void)
  */
 static void SendTowerNumber(void)
 {
-  (void) Packet_Put(TOWER_NUMBER, 1, NvTowerNb->s.Lo, NvTowerNb->s.Hi);
+  (void) Packet_Put(&TowerLink, TOWER_NUMBER, 1, NvTowerNb->s.Lo, NvTowerNb->s.Hi);
 }
 
 /*! @brief Send the "Tower Mode" response packet
@@ -148,7 +220,7 @@ static void SendTowerNumber(void)
  */
 static void SendTowerMode(void)
 {
-  (void) Packet_Put(TOWER_MODE, 1, NvTowerMode->s.Lo, NvTowerMode->s.Hi);
+  (void) Packet_Put(&TowerLink, TOWER_MODE, 1, NvTowerMode->s.Lo, NvTowerMode->s.Hi);
 }
 
 /*! @brief Send the "Protocol - Mode" response packet
@@ -157,122 +229,150 @@ static void SendTowerMode(void)
  * Parameter 1: 1
  * Parameter 2: 0 = asynchronous
  *              1 = synchronous
- * Parameter 3: 0
+ *              2 = framed
+ * Parameter 3: Samples of each channel per "Analog Input - Frame" when framed, otherwise 0
  *
  */
 static void SendProtocolMode(void)
 {
-  (void) Packet_Put(PROTOCOL_MODE, 1, TowerProtocolMode, 0);
+  (void) Packet_Put(&TowerLink, PROTOCOL_MODE, 1, TowerProtocolMode, (TowerProtocolMode == FRAMED) ? AnalogFrameNbSamples : 0);
 }
 
-/*! @brief Send the "Time" packet
+/*! @brief Send the "Protocol - Mode" transport response packet
  *
- * Command: 0x0C
- * Parameter 1: hours (0-23)
- * Parameter 2: minutes (0-59)
- * Parameter 3: seconds (0-59)
+ * Command: 0x0A
+ * Parameter 1: 3
+ * Parameter 2: 0 = raw 5 byte packets
+ *              1 = COBS encoded, each packet or frame followed by a 0x00 delimiter
+ * Parameter 3: 0
  *
  */
-static void SendTime(void)
+static void SendProtocolTransport(void)
 {
-  // Get value from the real time clock
-  uint8_t hours, minutes, seconds;
-  RTC_Get(&hours, &minutes, &seconds);
-
-  // Transmit time
-  (void) Packet_Put(TIME, hours, minutes, seconds);
+  (void) Packet_Put(&TowerLink, PROTOCOL_MODE, 3, Packet_GetTransport(&TowerLink), 0);
 }
 
-/*! @brief Send the "Analog Input - Value" packet
+/*! @brief Send the "Protocol - Mode" acknowledgement window response packet
+ *
+ * Command: 0x0A
+ * Parameter 1: 5
+ * Parameter 2: Sequenced packets the PC may have in flight, 0 for stop-and-wait
+ * Parameter 3: The largest window size
  *
- * Command: 0x50
- * Parameter 1: Channel Nb (0-7) (currently only 0 & 1 are implemented)
- * Parameter 2: LSB
- * Parameter 3: MSB
  */
-static void SendAnalogValue(uint8_t channelNb, int16union_t value)
+static void SendProtocolWindow(void)
 {
-  (void) Packet_Put(ANALOG_INPUT, channelNb, value.s.Lo, value.s.Hi);
+  (void) Packet_Put(&TowerLink, PROTOCOL_MODE, 5, WindowSize, PROTOCOL_MAX_WINDOW_SIZE);
 }
 
-/*! @brief Handles the "Get startup values" packet
+/*! @brief Send the "Protocol - Acknowledge" packet
  *
- * Command: 0x04
- * Parameter 1: 0
- * Parameter 2: 0
- * Parameter 3: 0
+ * Command: 0x33
+ * Parameter 1: The sequence number of the next packet expected, every earlier one has been handled
+ * Parameter 2: The sequence number of the last packet that failed
+ * Parameter 3: The number of packets that have failed, modulo 256
  *
- * In response to the "Get startup values" packet, we should transmit the following packets:
- * - a '0x04 Tower startup' packet
- * - a '0x09 Special ' Tower version' packet
- * - a '0x0B Tower Number' packet
- * - a "0x0D Tower Mode" packet
- * - a "0x0A Protocol - Mode" packet
+ * The PC tells which packets failed from Parameter 3 changing, as one is sent as soon as a packet fails.
+ */
+static void SendProtocolAcknowledge(void)
+{
+  (void) Packet_Put(&TowerLink, PROTOCOL_ACKNOWLEDGE, NextSequenceNb, LastFailedSequenceNb, NbFailed);
+  NbUnacknowledged = 0;
+}
+
+/*! @brief Send the "UART - Baud Rate" response packets
  *
- *  @return bool - TRUE if the packet was successfully handled.
+ * Command: 0x31
+ * Parameter 1: 1
+ * Parameter 2: LSB of the baud rate / 100
+ * Parameter 3: MSB of the baud rate / 100
+ *
+ * Command: 0x31
+ * Parameter 1: 3
+ * Parameter 2: LSB of the signed error of the achieved baud rate, in ppm
+ * Parameter 3: MSB of the signed error of the achieved baud rate, in ppm
  */
-static bool HandleStartup(void)
+static void SendBaudRate(void)
 {
-  if (Packet_Parameter1 == 0 && Packet_Parameter2 == 0
-      && Packet_Parameter3 == 0)
-  {
-    // Transmit the five required packets to the PC
-    SendStartup();
-    SendVersion();
-    SendTowerNumber();
-    SendTowerMode();
-    SendProtocolMode();
-    return true;
-  }
+  TUARTBaudRate settings;
+  uint16union_t rate, error;
 
-  return false;
+  UART_GetBaudRate(TOWER_UART, &settings);
+  rate.l = settings.BaudRate / 100;
+  error.l = (uint16_t) (int16_t) settings.ErrorPPM; // Accepted baud rates are within +-2%, so the error always fits
+
+  (void) Packet_Put(&TowerLink, UART_BAUD_RATE, 1, rate.s.Lo, rate.s.Hi);
+  (void) Packet_Put(&TowerLink, UART_BAUD_RATE, 3, error.s.Lo, error.s.Hi);
 }
 
-/*! @brief Handles the "Flash - Program byte" packet
+/*! @brief Send a "FIFO - Statistics" packet
  *
- * Command: 0x07
- * Parameter 1: When 0-7 Address offset, when 8 'erase sector'
- * Parameter 2: 0
- * Parameter 3: data
+ * Command: 0x30
+ * Parameter 1: FIFO number (high nibble) and statistic number (low nibble)
+ * Parameter 2: LSB
+ * Parameter 3: MSB
  *
- * No response
+ * @param fifoNb The FIFO the statistic is for.
+ * @param statisticNb The statistic being sent.
+ * @param value The value of the statistic.
+ */
+static void SendFIFOStatistic(uint8_t fifoNb, uint8_t statisticNb, uint16_t value)
+{
+  uint16union_t valueParts;
+  valueParts.l = value;
+
+  (void) Packet_Put(&TowerLink, FIFO_STATISTICS, (fifoNb << 4) | statisticNb, valueParts.s.Lo, valueParts.s.Hi);
+}
+
+/*! @brief Send a 32-bit FIFO statistic as two "FIFO - Statistics" packets, the low half first
  *
- * @return bool - TRUE if the packet was successfully handled.
+ * @param fifoNb The FIFO the statistic is for.
+ * @param statisticNb The statistic being sent, the high half is sent as statisticNb + 1.
+ * @param value The value of the statistic.
  */
-static bool HandleProgramByte(void)
+static void SendFIFOStatistic32(uint8_t fifoNb, uint8_t statisticNb, uint32_t value)
 {
-  // Validate parameters
-  if (Packet_Parameter2 != 0 || Packet_Parameter1 > 8)
-    return false;
+  uint32union_t valueParts;
+  valueParts.l = value;
 
-  if (Packet_Parameter1 == 8)
-    return Flash_Erase();
+  SendFIFOStatistic(fifoNb, statisticNb, valueParts.s.Lo);
+  SendFIFOStatistic(fifoNb, statisticNb + 1, valueParts.s.Hi);
+}
 
-  // Write to Flash
-  volatile uint8_t * address =
-      (uint8_t *) (FLASH_DATA_START + Packet_Parameter1);
-  return Flash_Write8(address, Packet_Parameter3);
+/*! @brief Send the five packets the PC expects at startup
+ *
+ * - a '0x04 Tower startup' packet
+ * - a '0x09 Special ' Tower version' packet
+ * - a '0x0B Tower Number' packet
+ * - a "0x0D Tower Mode" packet
+ * - a "0x0A Protocol - Mode" packet
+ */
+static void SendStartupValues(void)
+{
+  SendStartup();
+  SendVersion();
+  SendTowerNumber();
+  SendTowerMode();
+  SendProtocolMode();
 }
 
-/*! @brief Handles the "Flash - Read Byte" packet
+/*! @brief Handles the "Get startup values" packet
  *
- * Command: 0x08,
- * Parameter 1: Offset (0-7)
+ * Command: 0x04
+ * Parameter 1: 0
  * Parameter 2: 0
  * Parameter 3: 0
  *
- * Response: Send the "Flash Byte" packet
+ * In response to the "Get startup values" packet, we should transmit the startup packets.
  *
- * @return bool - TRUE if the packet was successfully handled.
+ *  @param link The link the packet was received on.
+ *  @param packet The received packet.
+ *  @return bool - TRUE if the packet was successfully handled.
  */
-static bool HandleReadByte(void)
+static bool HandleStartup(TPacketLink* const link, const TPacket* const packet)
 {
-  if (Packet_Parameter23 != 0 || Packet_Parameter1 > 7)
-    return false;
-
-  // Keep consistent with other impl that dont return false when the packet put fails
-  (void) Packet_Put(FLASH_READ, Packet_Parameter1, 0,
-      _FB(FLASH_DATA_START + Packet_Parameter1));
+  // Transmit the five required packets to the PC
+  SendStartupValues();
   return true;
 }
 
@@ -286,20 +386,22 @@ static bool HandleReadByte(void)
  *
  * Response: None
  *
+ * @param link The link the packet was received on.
+ * @param packet The received packet.
  * @return bool - TRUE if the packet was successfully handled.
  */
-static bool HandleTowerMode(void)
+static bool HandleTowerMode(TPacketLink* const link, const TPacket* const packet)
 {
-  if (Packet_Parameter1 == 1 && Packet_Parameter23 == 0)
+  if (Packet_Parameter1(packet) == 1 && Packet_Parameter23(packet) == 0)
   {
     // Get tower mode
     SendTowerMode();
     return true;
   }
-  else if (Packet_Parameter1 == 2)
+  else if (Packet_Parameter1(packet) == 2)
   {
     // Set tower mode
-    return Flash_Write16((uint16_t *) NvTowerMode, Packet_Parameter23);
+    return Flash_Write16((uint16_t *) NvTowerMode, Packet_Parameter23(packet));
   }
 
   // Invalid command
@@ -311,26 +413,79 @@ static bool HandleTowerMode(void)
  * Command: 0x0A
  * Parameter 1:  1 = get Protocol mode
  *               2 = set Protocol mode
- * Parameter 2: 0 = asynchronous for a 'set', 0 for a 'get'
- *              1 = synchronous for a 'set', 0 for a 'get'
- * Parameter 3: 0
+ *               3 = get transport
+ *               4 = set transport
+ *               5 = get acknowledgement window
+ *               6 = set acknowledgement window
+ * Parameter 2: 0 = asynchronous for a mode 'set', raw for a transport 'set', 0 for a 'get'
+ *              1 = synchronous for a mode 'set', COBS for a transport 'set', 0 for a 'get'
+ *              2 = framed for a mode 'set', 0 for a 'get'
+ *              Window size for a window 'set', 0 for stop-and-wait
+ * Parameter 3: Samples of each channel per "Analog Input - Frame" for a framed 'set', 0 for the most that fit,
+ *              otherwise 0
  *
- * Response: None
+ * Response: "Protocol - Mode" packet for a 'get'
+ *
+ * A PC that does not understand frames never asks for them, and keeps receiving "Analog Input - Value" packets.
+ * Likewise the transport stays raw until the PC asks for COBS. The ACK is sent on the old transport,
+ * and everything after it on the new one. The Tower always starts on the raw transport.
  *
+ * With a window, each packet from the PC has a sequence number after Parameter 3, starting from 0 when the
+ * window is first set, and the PC may send that many before they are acknowledged by "Protocol - Acknowledge".
+ * The acknowledgement request bit is then ignored. Setting the window back to 0 returns to 5 byte packets.
+ *
+ * @param link The link the packet was received on.
+ * @param packet The received packet.
  * @return bool - TRUE if the packet was successfully handled.
  */
-static bool HandleProtocolMode(void)
+static bool HandleProtocolMode(TPacketLink* const link, const TPacket* const packet)
 {
-  if (Packet_Parameter1 == 1 && Packet_Parameter23 == 0)
+  if (Packet_Parameter1(packet) == 1 && Packet_Parameter23(packet) == 0)
   {
     // Get protocol mode
     SendProtocolMode();
     return true;
   }
-  else if (Packet_Parameter1 == 2 && Packet_Parameter2 <= 1 && Packet_Parameter3 == 0)
+  else if (Packet_Parameter1(packet) == 2 && Packet_Parameter2(packet) == FRAMED && Packet_Parameter3(packet) <= ANALOG_FRAME_MAX_NB_SAMPLES)
+  {
+    // Set framed Protocol Mode, with the number of samples per frame, leaving behind any values from before
+    AnalogFrameNbSamples = (Packet_Parameter3(packet) != 0) ? Packet_Parameter3(packet) : ANALOG_FRAME_MAX_NB_SAMPLES;
+    if (TowerProtocolMode != FRAMED)
+      AnalogFramedTick = AnalogTick;
+    TowerProtocolMode = FRAMED;
+    return true;
+  }
+  else if (Packet_Parameter1(packet) == 2 && Packet_Parameter2(packet) <= SYNCHRONOUS && Packet_Parameter3(packet) == 0)
   {
     // Set Protocol Mode
-    TowerProtocolMode = Packet_Parameter2;
+    TowerProtocolMode = Packet_Parameter2(packet);
+    return true;
+  }
+  else if (Packet_Parameter1(packet) == 3 && Packet_Parameter23(packet) == 0)
+  {
+    // Get transport
+    SendProtocolTransport();
+    return true;
+  }
+  else if (Packet_Parameter1(packet) == 4 && Packet_Parameter2(packet) <= PACKET_TRANSPORT_COBS && Packet_Parameter3(packet) == 0)
+  {
+    // Set transport
+    PendingTransport = Packet_Parameter2(packet);
+    TransportPending = true;
+    return true;
+  }
+  else if (Packet_Parameter1(packet) == 5 && Packet_Parameter23(packet) == 0)
+  {
+    // Get acknowledgement window
+    SendProtocolWindow();
+    return true;
+  }
+  else if (Packet_Parameter1(packet) == 6 && Packet_Parameter2(packet) <= PROTOCOL_MAX_WINDOW_SIZE
+      && Packet_Parameter3(packet) == 0)
+  {
+    // Set acknowledgement window
+    PendingWindowSize = Packet_Parameter2(packet);
+    WindowPending = true;
     return true;
   }
 
@@ -347,13 +502,15 @@ static bool HandleProtocolMode(void)
  * Parameter 2: 'x'
  * Parameter 3: CR
  *
+ *  @param link The link the packet was received on.
+ *  @param packet The received packet.
  *  @return bool - TRUE if the packet was successfully handled.
  */
-static bool HandleSpecial(void)
+static bool HandleSpecial(TPacketLink* const link, const TPacket* const packet)
 {
   // Verify that the received command was for "Get version"
-  if (Packet_Parameter1 == 'v' && Packet_Parameter2 == 'x'
-      && Packet_Parameter3 == '\r') // CR
+  if (Packet_Parameter1(packet) == 'v' && Packet_Parameter2(packet) == 'x'
+      && Packet_Parameter3(packet) == '\r') // CR
   {
     // Transmit the version number to the PC
     SendVersion();
@@ -373,85 +530,149 @@ static bool HandleSpecial(void)
  * Parameter 3: MSB for a 'set', 0 for a 'get'
  * @note The Tower number is an unsigned 16-bit number
  *
+ *  @param link The link the packet was received on.
+ *  @param packet The received packet.
  *  @return bool - TRUE if the packet was successfully handled.
  */
-static bool HandleTowerNumber(void)
+static bool HandleTowerNumber(TPacketLink* const link, const TPacket* const packet)
 {
-  if (Packet_Parameter1 == 1 // 1 = get Tower Number
+  if (Packet_Parameter1(packet) == 1 // 1 = get Tower Number
   // Verify Parameter 2 and 3
-  && Packet_Parameter23 == 0) // 0 for a "get"
+  && Packet_Parameter23(packet) == 0) // 0 for a "get"
   {
     // Transmit the Tower Number to the PC
     SendTowerNumber();
     return true;
   }
-  else if (Packet_Parameter1 == 2) // 2 = set Tower Number
+  else if (Packet_Parameter1(packet) == 2) // 2 = set Tower Number
   {
-    return Flash_Write16((uint16_t *) NvTowerNb, Packet_Parameter23);
+    return Flash_Write16((uint16_t *) NvTowerNb, Packet_Parameter23(packet));
   }
 
   // Invalid packet, likely called get with non zeroed parameter 2/3
   return false;
 }
 
-/*! @brief Handles the Set Time PC To Tower Command
+/*! @brief Handles the "FIFO - Statistics" packet
+ *
+ * Command: 0x30
+ * Parameter 1: FIFO number, 0 = UART control transmit, 1 = UART receive, 2 + channel = analog samples,
+ *              14 = UART time transmit, 15 = UART telemetry transmit
+ * Parameter 2: 0
+ * Parameter 3: 0
  *
- * Command: 0x0C
- * Parameter 1: hours (0-23)
- * Parameter 2: minutes (0-59)
- * Parameter 3: seconds (0-59)
+ * Response: One "FIFO - Statistics" packet for each FIFOStatistic value
  *
+ *  @param link The link the packet was received on.
+ *  @param packet The received packet.
  *  @return bool - TRUE if the packet was successfully handled.
  */
-static bool HandleSetTime(void)
+static bool HandleFIFOStatistics(TPacketLink* const link, const TPacket* const packet)
 {
-  // Check that the parameters are a valid time
-  if ((Packet_Parameter1 >= 24) || (Packet_Parameter2 >= 60)
-      || (Packet_Parameter3 >= 60))
+  TFIFOStatistics statistics;
+  bool enabled;
+
+  if (Packet_Parameter1(packet) == FIFO_UART_TX_CONTROL)
+  {
+    enabled = UART_GetTxStatistics(TOWER_UART, UART_TX_CONTROL, &statistics);
+  }
+  else if (Packet_Parameter1(packet) == FIFO_UART_TX_TIME)
+  {
+    enabled = UART_GetTxStatistics(TOWER_UART, UART_TX_TIME, &statistics);
+  }
+  else if (Packet_Parameter1(packet) == FIFO_UART_TX_TELEMETRY)
+  {
+    enabled = UART_GetTxStatistics(TOWER_UART, UART_TX_TELEMETRY, &statistics);
+  }
+  else if (Packet_Parameter1(packet) == FIFO_UART_RX)
+  {
+    enabled = UART_GetRxStatistics(TOWER_UART, &statistics);
+  }
+  else if (Packet_Parameter1(packet) < FIFO_ANALOG + ANALOG_NB_INPUTS)
+  {
+    enabled = AnalogFIFO_GetStatistics(&AnalogProcessingThreadSettings[Packet_Parameter1(packet) - FIFO_ANALOG].Samples, &statistics);
+  }
+  else
+  {
+    // Invalid FIFO number
+    return false;
+  }
+
+  // Statistics were compiled out
+  if (!enabled)
     return false;
 
-  // Set the RTC clock
-  RTC_Set(Packet_Parameter1, Packet_Parameter2, Packet_Parameter3);
+  SendFIFOStatistic(Packet_Parameter1(packet), FIFO_STATISTIC_NB_ELEMENTS, statistics.NbElements);
+  SendFIFOStatistic(Packet_Parameter1(packet), FIFO_STATISTIC_PEAK_NB_ELEMENTS, statistics.PeakNbElements);
+  SendFIFOStatistic32(Packet_Parameter1(packet), FIFO_STATISTIC_NB_PUT, statistics.NbPut);
+  SendFIFOStatistic32(Packet_Parameter1(packet), FIFO_STATISTIC_NB_GET, statistics.NbGet);
+  SendFIFOStatistic32(Packet_Parameter1(packet), FIFO_STATISTIC_NB_DROPPED, statistics.NbDropped);
+  SendFIFOStatistic32(Packet_Parameter1(packet), FIFO_STATISTIC_PUT_BLOCKED_TICKS, statistics.PutBlockedTicks);
+  SendFIFOStatistic32(Packet_Parameter1(packet), FIFO_STATISTIC_GET_BLOCKED_TICKS, statistics.GetBlockedTicks);
   return true;
 }
 
-/*! @brief Handles the received and verified packet based on its command byte.
+/*! @brief Handles the "UART - Baud Rate" packet
+ *
+ * Command: 0x31
+ * Parameter 1: 1 = get baud rate
+ *              2 = set baud rate
+ * Parameter 2: LSB of the baud rate / 100 for a 'set', 0 for a 'get'
+ * Parameter 3: MSB of the baud rate / 100 for a 'set', 0 for a 'get'
  *
+ * Response: "UART - Baud Rate" packets for a 'get'
+ *
+ * A 'set' is applied after its ACK has been sent at the old baud rate,
+ * so the PC should request the ACK and change its own baud rate once the ACK arrives.
+ *
+ *  @param link The link the packet was received on.
+ *  @param packet The received packet.
  *  @return bool - TRUE if the packet was successfully handled.
  */
-static bool HandlePacket(void)
+static bool HandleBaudRate(TPacketLink* const link, const TPacket* const packet)
 {
-  // Switch on Packet Command after zeroing acknowledgment bit
-  switch (Packet_Command & ~PACKET_ACK_MASK)
-  {
-  case STARTUP:
-    return HandleStartup();
-
-  case FLASH_PROG:
-    return HandleProgramByte();
-
-  case FLASH_READ:
-    return HandleReadByte();
-
-  case SPECIAL:
-    return HandleSpecial();
-
-  case TOWER_NUMBER:
-    return HandleTowerNumber();
+  TUARTBaudRate settings;
 
-  case TIME:
-    return HandleSetTime();
+  if (Packet_Parameter1(packet) == 1 && Packet_Parameter23(packet) == 0)
+  {
+    // Get baud rate
+    SendBaudRate();
+    return true;
+  }
+  else if (Packet_Parameter1(packet) == 2)
+  {
+    // Set baud rate, if it can be generated accurately enough
+    if (!UART_CalculateBaudRate((uint32_t) Packet_Parameter23(packet) * 100, CPU_BUS_CLK_HZ, &settings))
+      return false;
 
-  case TOWER_MODE:
-    return HandleTowerMode();
+    PendingBaudRate = settings.BaudRate;
+    return true;
+  }
 
-  case PROTOCOL_MODE:
-    return HandleProtocolMode();
+  // Invalid command
+  return false;
+}
 
-    // Received invalid or unimplemented packet
-  default:
-    return false;
-  }
+/*! @brief Registers the handlers of the Tower commands on the Tower link.
+ *
+ *  Each handler is given the packet once the parameters that must be 0 have been checked.
+ *  The packet, Flash, RTC and analog modules register their own commands, main only those that use its state.
+ *
+ *  @return bool - TRUE if every command was registered.
+ */
+static bool RegisterCommands(void)
+{
+  return Packet_RegisterCommands(&TowerLink)
+      & Flash_RegisterCommands(&TowerLink)
+      & RTC_RegisterCommands(&TowerLink)
+      & Analog_RegisterCommands(&TowerLink)
+      & Packet_Register(&TowerLink, STARTUP, HandleStartup, PACKET_PARAMETERS_ZERO)
+      & Packet_Register(&TowerLink, SPECIAL, HandleSpecial, 0)
+      & Packet_Register(&TowerLink, TOWER_NUMBER, HandleTowerNumber, 0)
+      & Packet_Register(&TowerLink, TOWER_MODE, HandleTowerMode, 0)
+      & Packet_Register(&TowerLink, PROTOCOL_MODE, HandleProtocolMode, 0)
+      & Packet_Register(&TowerLink, FIFO_STATISTICS, HandleFIFOStatistics, PACKET_PARAMETER2_ZERO | PACKET_PARAMETER3_ZERO)
+      & Packet_Register(&TowerLink, UART_BAUD_RATE, HandleBaudRate, 0);
 }
 
 /*! @brief Sends the ACK/NAK packet if the Packet Command requires it
@@ -459,20 +680,54 @@ static bool HandlePacket(void)
  *   If acknowledgement is requested, the received packet is echoed.
  *   Bit 7 in the Command byte is used to indicate that the command was successful (ACK/NAK)
  *
+ *  @param packet The received packet.
  *  @param wasSuccess Whether the packet was handled successfully
  */
-static void SendAcknowledgeIfRequired(bool wasSuccess)
+static void SendAcknowledgeIfRequired(const TPacket* const packet, bool wasSuccess)
 {
   // Check if Acknowledgement was requested
-  if (Packet_Command & PACKET_ACK_MASK)
+  if (Packet_Command(packet) & PACKET_ACK_MASK)
   {
     // Create mask for ACK/NAK
     // Makes: X111 1111, where X is wasSuccess
     const uint8_t acknowledgeMask = (wasSuccess << 7) | ~PACKET_ACK_MASK;
 
     // Echo the Packet with bit acknowledgement flag set on the command byte
-    (void) Packet_Put(Packet_Command & acknowledgeMask, Packet_Parameter1,
-    Packet_Parameter2, Packet_Parameter3);
+    (void) Packet_Put(&TowerLink, Packet_Command(packet) & acknowledgeMask, Packet_Parameter1(packet),
+    Packet_Parameter2(packet), Packet_Parameter3(packet));
+  }
+}
+
+/*! @brief Handles a sequenced packet, acknowledging it cumulatively
+ *
+ *  Packets are handled strictly in sequence. One that is out of sequence (after a packet was lost, or a repeat
+ *  of one already handled) is discarded, and the PC told where to resume.
+ *  Otherwise the acknowledgement is held back while more packets are waiting, up to half the window,
+ *  unless the packet switches the baud rate, transport or window, which must be acknowledged before the switch.
+ *
+ *  @param packet The received packet.
+ */
+static void HandleSequencedPacket(const TPacket* const packet)
+{
+  if (Packet_SequenceNb(packet) != NextSequenceNb)
+  {
+    SendProtocolAcknowledge();
+    return;
+  }
+
+  NextSequenceNb++;
+  NbUnacknowledged++;
+
+  if (!Packet_Dispatch(&TowerLink, packet))
+  {
+    LastFailedSequenceNb = Packet_SequenceNb(packet);
+    NbFailed++;
+    SendProtocolAcknowledge();
+  }
+  else if (NbUnacknowledged >= (WindowSize + 1) / 2 || PendingBaudRate != 0 || TransportPending || WindowPending
+      || !Packet_IsAvailable(&TowerLink))
+  {
+    SendProtocolAcknowledge();
   }
 }
 
@@ -488,13 +743,17 @@ static void SendAcknowledgeIfRequired(bool wasSuccess)
  */
 static void PITCallback(void* args)
 {
-  // Sample analog channels
+  // Sample analog channels, stamping each with this tick so the frames can pair the channels up again
+  const uint32_t tick = AnalogTick++;
+
   for (uint8_t i = 0; i < ANALOG_NB_INPUTS; i++)
   {
-    if (Analog_Get(i))
+    TAnalogSample sample = { .Tick = tick };
+
+    if (Analog_Sample(i, &sample.Value))
     {
-      // If we receive an analog value, signal the processing background thread
-      OS_SemaphoreSignal(AnalogProcessingThreadSettings[i].Semaphore);
+      // If we receive an analog value, pass it to the processing background thread
+      (void) AnalogFIFO_Put(&AnalogProcessingThreadSettings[i].Samples, sample);
     }
   }
 
@@ -509,7 +768,7 @@ static void PITCallback(void* args)
   }
 }
 
-/*! @brief Initialises the Packet, Flash, LED, RTC, PIT, OS, FTM and Analog modules.
+/*! @brief Initialises the CRC, Packet, Flash, LED, RTC, PIT, OS, FTM and Analog modules.
  *  Switches on the Orange LED when successful
  *
  * @return bool - true if all modules were successfully initialised
@@ -522,7 +781,7 @@ static void InitializeComponents(void)
 
   RTCSemaphore = OS_SemaphoreCreate(0);
 
-  bool worked = Packet_Init(BAUD_RATE, CPU_BUS_CLK_HZ) & Flash_Init()
+  bool worked = CRC_Init() & Packet_Init(&TowerLink, TOWER_UART, BAUD_RATE, CPU_BUS_CLK_HZ) & RegisterCommands() & Flash_Init()
       & LEDs_Init() & RTC_Init(RTCSemaphore)
       & PIT_Init(CPU_BUS_CLK_HZ, &PITCallback, NULL) & FTM_Init()
       & Analog_Init(CPU_BUS_CLK_HZ);
@@ -531,6 +790,15 @@ static void InitializeComponents(void)
     LEDs_On(LED_ORANGE);
   else
     PE_DEBUGHALT();
+
+#ifdef CRC_BENCHMARK
+  static uint8_t benchmarkData[CRC_BENCHMARK_NB_BYTES];
+
+  for (uint32_t i = 0; i < CRC_BENCHMARK_NB_BYTES; i++)
+    benchmarkData[i] = (uint8_t) i;
+
+  CRCBenchmarkAgreed = CRC_Benchmark(benchmarkData, CRC_BENCHMARK_NB_BYTES, &CRCBenchmark);
+#endif
 }
 
 /*! @brief Allocates a block of Flash Memory and sets a default if the block is empty
@@ -584,7 +852,7 @@ static void RTCTimerThread(void* args)
     WaitForever(RTCSemaphore);
 
     LEDs_Toggle(LED_YELLOW); // Toggle the Yellow LED
-    SendTime(); // Transmit a time packet to the PC
+    RTC_SendTime(&TowerLink); // Transmit a time packet to the PC
   }
 }
 
@@ -608,46 +876,142 @@ static void FTMLightThread(void* args)
  */
 static void AnalogProcessingThread(void * arg)
 {
-  TAnalogThread settings = *(TAnalogThread*) arg;
+  TAnalogThread * const settings = (TAnalogThread*) arg;
+  TAnalogSample sample;
+
   for (;;)
   {
-    // Wait for the analog thread to be signalled (i.e. sample a value)
-    WaitForever(settings.Semaphore);
+    // Wait for the PIT to sample a value, and add it to the "sliding window"
+    AnalogFIFO_BlockingGet(&settings->Samples, &sample);
+    Analog_Put(settings->ChannelNb, sample.Value);
 
-    settings.Values->oldValue = settings.Values->value; // Set old value
+    settings->Values->oldValue = settings->Values->value; // Set old value
 
     // Set value to the current median of "sliding window"
-    settings.Values->value.l = Median_Filter(settings.Values->values, ANALOG_WINDOW_SIZE);
+    settings->Values->value.l = Median_Filter(settings->Values->values, ANALOG_WINDOW_SIZE);
+
+    // Hand every value to the analog frame thread to be batched, with the tick it was sampled on
+    if (TowerProtocolMode == FRAMED)
+    {
+      sample.Value = settings->Values->value.l;
+      (void) AnalogFIFO_Put(&settings->FrameValues, sample);
+      continue;
+    }
 
     // From the spec:
     // When SYNCHRONOUS: Send every 10ms
     // When ASYNCHRONOUS: Send when value has changed, at intervals no greater than 10ms
     if (TowerProtocolMode == SYNCHRONOUS
 #ifdef TRANSMIT_ASYNC_PACKETS
-        || (settings.Values->oldValue.l != settings.Values->value.l)
+        || (settings->Values->oldValue.l != settings->Values->value.l)
 #endif
         )
 
     {
       // Transmit analog value to the PC
-      SendAnalogValue(settings.ChannelNb, settings.Values->value);
+      Analog_SendValue(&TowerLink, settings->ChannelNb, settings->Values->value);
     }
   }
 }
 
+/*! @brief Gets the values of every channel sampled on the same PIT tick, for the analog frame thread.
+ *
+ *  A channel's value is missing from a tick if its FIFO was full, or the mode changed between the channels handing
+ *  over their values. The values of the other channels on that tick are discarded, as are values from before framed
+ *  mode was last entered, so the channels of a frame always line up.
+ *
+ *  @param values A pointer to store a value of each channel, in channel order.
+ *  @return uint32_t - The tick the values were sampled on.
+ */
+static uint32_t GetFrameValues(int16union_t values[])
+{
+  TAnalogSample samples[ANALOG_NB_INPUTS];
+  uint32_t tick;
+  bool aligned;
+  uint8_t channelNb;
+
+  for (channelNb = 0; channelNb < ANALOG_NB_INPUTS; channelNb++)
+    AnalogFIFO_BlockingGet(&AnalogProcessingThreadSettings[channelNb].FrameValues, &samples[channelNb]);
+
+  do
+  {
+    // Catch every channel up to the newest tick any of them is on
+    tick = AnalogFramedTick;
+    for (channelNb = 0; channelNb < ANALOG_NB_INPUTS; channelNb++)
+      if ((int32_t)(samples[channelNb].Tick - tick) > 0)
+        tick = samples[channelNb].Tick;
+
+    aligned = true;
+    for (channelNb = 0; channelNb < ANALOG_NB_INPUTS; channelNb++)
+    {
+      while ((int32_t)(samples[channelNb].Tick - tick) < 0)
+        AnalogFIFO_BlockingGet(&AnalogProcessingThreadSettings[channelNb].FrameValues, &samples[channelNb]);
+
+      // Overshot, so the other channels have to catch up to this one
+      if (samples[channelNb].Tick != tick)
+        aligned = false;
+    }
+  } while (!aligned);
+
+  for (channelNb = 0; channelNb < ANALOG_NB_INPUTS; channelNb++)
+    values[channelNb].l = samples[channelNb].Value;
+
+  return tick;
+}
+
+/*! @brief Thread that batches the analog values of every channel into "Analog Input - Frame" frames, in framed mode.
+ *
+ *  Waits for nothing but the values, so it simply stays blocked while the Tower is in another mode.
+ *
+ *  @param ignored Unused
+ */
+static void AnalogFrameThread(void * ignored)
+{
+  int16union_t samples[ANALOG_FRAME_MAX_NB_SAMPLES * ANALOG_NB_INPUTS];
+  uint8_t sequenceNb = 0;
+
+  for (;;)
+  {
+    uint8_t nbSamples = AnalogFrameNbSamples;
+    uint32_t firstTick = 0;
+
+    for (uint8_t i = 0; i < nbSamples; i++)
+    {
+      const uint32_t tick = GetFrameValues(&samples[i * ANALOG_NB_INPUTS]);
+
+      if (i == 0)
+        firstTick = tick;
+      else if ((int32_t)(firstTick - AnalogFramedTick) < 0)
+      {
+        // Framed mode was left and entered again part way through the frame, so start a new frame with these values
+        for (uint8_t channelNb = 0; channelNb < ANALOG_NB_INPUTS; channelNb++)
+          samples[channelNb] = samples[i * ANALOG_NB_INPUTS + channelNb];
+
+        nbSamples = AnalogFrameNbSamples;
+        firstTick = tick;
+        i = 0;
+      }
+    }
+
+    Analog_SendFrame(&TowerLink, sequenceNb++, nbSamples, samples);
+  }
+}
+
 /*! @brief Thread that listens for and responds to packets for the Tower Protocol.
  *
  *  @param ignored Unused
  */
 static void ProtocolProcessingThread(void * ignored)
 {
+  TPacket packet;
+
   // Send startup packets as per Tower To PC Protocol
-  HandleStartup();
+  SendStartupValues();
 
   for (;;)
   {
     // Blocking call, awaits valid packet
-    Packet_Get();
+    Packet_Get(&TowerLink, &packet);
 
     // "On reception of a valid packet from the PC, the blue LED must be turned
     // on for a period of one  second"
@@ -657,11 +1021,47 @@ static void ProtocolProcessingThread(void * ignored)
     LEDs_On(LED_BLUE);
     FTM_StartTimer(&LedTimerChannel); // (Asynchronously) turn off the Blue LED after 1 second
 
-    // Handle the received Packet based on the Packet Command
-    const bool correctlyHandled = HandlePacket();
+    if (WindowSize != 0)
+    {
+      HandleSequencedPacket(&packet);
+    }
+    else
+    {
+      // Handle the received Packet with the handler registered for its command
+      const bool correctlyHandled = Packet_Dispatch(&TowerLink, &packet);
+
+      // Transmit ACK/NAK packet to the PC if required
+      SendAcknowledgeIfRequired(&packet, correctlyHandled);
+    }
+
+    // A new baud rate is only applied once the ACK has been sent at the old one
+    if (PendingBaudRate != 0)
+    {
+      (void) UART_SetBaudRate(TOWER_UART, PendingBaudRate);
+      PendingBaudRate = 0;
+    }
+
+    // Likewise a new transport
+    if (TransportPending)
+    {
+      Packet_SetTransport(&TowerLink, PendingTransport);
+      TransportPending = false;
+    }
 
-    // Transmit ACK/NAK packet to the PC if required
-    SendAcknowledgeIfRequired(correctlyHandled);
+    // And a new acknowledgement window, the sequence numbers starting afresh when one is opened
+    if (WindowPending)
+    {
+      if (WindowSize == 0)
+      {
+        NextSequenceNb = 0;
+        LastFailedSequenceNb = 0;
+        NbFailed = 0;
+      }
+
+      WindowSize = PendingWindowSize;
+      Packet_SetSequenced(&TowerLink, WindowSize != 0);
+      WindowPending = false;
+    }
   }
 }
 
@@ -699,7 +1099,8 @@ int main(void)
 
   for (uint8_t channelNb = 0; channelNb < ANALOG_NB_INPUTS; channelNb++)
   {
-    AnalogProcessingThreadSettings[channelNb].Semaphore = OS_SemaphoreCreate(0);
+    AnalogFIFO_Init(&AnalogProcessingThreadSettings[channelNb].Samples);
+    AnalogFIFO_Init(&AnalogProcessingThreadSettings[channelNb].FrameValues);
     AnalogProcessingThreadSettings[channelNb].ChannelNb = channelNb;
     AnalogProcessingThreadSettings[channelNb].Values = &Analog_Input[channelNb];
 
@@ -709,6 +1110,7 @@ int main(void)
         10 - channelNb); /* Priority 10 & 9 */
   }
 
+  OS_ThreadCreate(AnalogFrameThread, NULL, &AnalogFrameThreadStack[THREAD_STACK_SIZE - 1], 11);
   OS_ThreadCreate(RTCTimerThread, NULL, &RTCThreadStack[THREAD_STACK_SIZE - 1], 6);
   OS_ThreadCreate(FTMLightThread, NULL, &FTMThreadStack[THREAD_STACK_SIZE - 1], 7);
   OS_ThreadCreate(ProtocolProcessingThread, NULL, &ProtocolProcessingThreadStack[THREAD_STACK_SIZE - 1], 1);
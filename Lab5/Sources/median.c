@@ -15,6 +15,10 @@
 
 #define MEDIAN_ARRAY_SIZE 1024
 
+// Windows up to this size are sorted on the caller's stack with an insertion sort,
+// which is faster than qsort for so few elements and safe to call from several threads
+#define MEDIAN_SMALL_ARRAY_SIZE 16
+
 static int16_t arrayForCloning[MEDIAN_ARRAY_SIZE];
 
 /*! @brief Sort Comparison Function
@@ -31,6 +35,27 @@ static int delta(const void * a, const void * b)
   return (int32_t)aInt - (int32_t)bInt;
 }
 
+/*! @brief Sorts a small array in place.
+ *
+ * @param array The array to sort.
+ * @param size The length of the array.
+ */
+static void InsertionSort(int16_t array[], const uint32_t size)
+{
+  uint32_t i, j;
+
+  for (i = 1; i < size; i++)
+  {
+    const int16_t value = array[i];
+
+    // Shift larger elements up to make room
+    for (j = i; j > 0 && array[j - 1] > value; j--)
+      array[j] = array[j - 1];
+
+    array[j] = value;
+  }
+}
+
 /*!
  * @addtogroup Median_module Median filter module documentation.
  * @{
@@ -47,21 +72,33 @@ int16_t Median_Filter(const int16_t array[], const uint32_t size)
   case 0: return 0;
   case 1: return array[0];
   case 2: return (array[0] + array[1]) / 2;
-  case 3: return array[1];
   }
 
-  memcpy(arrayForCloning, array, size * sizeof(int16_t));
+  int16_t smallArray[MEDIAN_SMALL_ARRAY_SIZE];
+  int16_t * sorted;
 
-  // Sort array in place - uses a quick sort variant (efficient) O(n*log(n))
-  qsort(arrayForCloning, size, sizeof(int16_t), delta);
+  if (size <= MEDIAN_SMALL_ARRAY_SIZE)
+  {
+    // Sort a copy on the stack - insertion sort O(n^2), but with no call overhead per comparison
+    sorted = smallArray;
+    memcpy(sorted, array, size * sizeof(int16_t));
+    InsertionSort(sorted, size);
+  }
+  else
+  {
+    // Sort array in place - uses a quick sort variant (efficient) O(n*log(n))
+    sorted = arrayForCloning;
+    memcpy(sorted, array, size * sizeof(int16_t));
+    qsort(sorted, size, sizeof(int16_t), delta);
+  }
 
   // Calculate the median
   int16_t result;
   if ((size % 2) == 1)
-    result = arrayForCloning[size / 2]; // Take middle element.
+    result = sorted[size / 2]; // Take middle element.
   else
     // Take average of two middle elements
-    result = (arrayForCloning[(size / 2) - 1] + arrayForCloning[size / 2]) / 2;
+    result = (sorted[(size / 2) - 1] + sorted[size / 2]) / 2;
 
   return result;
 }
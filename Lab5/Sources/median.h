@@ -18,6 +18,7 @@
  *
  *  @param array is an array half-words for which the median is sought.
  *  @param size is the length of the array. Cannot be greater than 1024
+ *  @note Arrays of up to 16 half-words may be filtered by several threads at once.
  */
 int16_t Median_Filter(const int16_t array[], const uint32_t size);
 
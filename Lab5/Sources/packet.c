@@ -19,150 +19,408 @@
 #include "UART.h"
 #include "Cpu.h"
 #include "OS.h"
+#include "CRC.h"
+#include "COBS.h"
+#include <string.h>
 
-#define PACKET_SIZE 5
+// Maximum OS ticks Packet_Put waits for a backed up transmitter, before dropping the packet
+#define PACKET_PUT_TIMEOUT 10
 
-TPacket Packet;
-
-static OS_ECB * PutMutex; /* Mutex used to ensure that only one thread will 'Put' at a time */
-
-static uint8_t PacketBuf[PACKET_SIZE]; /*!< Internal buffer used with packet error handling */
-static uint8_t BufNbBytes; /*!< Internal index for packet error handling */
-
-bool Packet_Init(const uint32_t baudRate, const uint32_t moduleClk)
+bool Packet_Init(TPacketLink* const link, TUART* const uart, const uint32_t baudRate, const uint32_t moduleClk)
 {
-  // Initialise the internal buffer's index
-  BufNbBytes = 0;
+  link->UART = uart;
 
-  // Create the Packet_Put and Packet_Get mutexes
-  PutMutex = OS_SemaphoreCreate(1);
+  // No commands are registered until the modules that implement them do so
+  memset(link->Commands, 0, sizeof(link->Commands));
+  link->NbUnknown = 0;
 
   // Initialise the UART and receive/transmit buffers
-  return UART_Init(baudRate, moduleClk);
+  if (!UART_Init(uart, baudRate, moduleClk))
+    return false;
+
+  link->Sequenced = false;
+  Packet_SetTransport(link, PACKET_TRANSPORT_RAW);
+  return true;
 }
 
-/*! @brief Read a byte from the UART receive buffer
+/*! @brief The size of the packets received on a link, including the check bytes
  *
- *  Appends a byte to the internal packet buffer if there is
- *  packet available in the UART Receive Buffer.
- *
- *  Blocks until the next byte is received
+ *  @param link The link.
+ *  @return uint8_t - PACKET_SEQUENCED_SIZE on a sequenced link, otherwise PACKET_SIZE.
+ */
+static uint8_t ReceivedSize(const TPacketLink* const link)
+{
+  return link->Sequenced ? PACKET_SEQUENCED_SIZE : PACKET_SIZE;
+}
+
+/*! @brief The number of bytes a received packet takes on the wire
  *
+ *  @param link The link.
+ *  @return uint16_t - The size of a received packet, plus the COBS overhead on a COBS link.
  */
-static void ReadNextByte(void)
+static uint16_t ReceivedWireSize(const TPacketLink* const link)
+{
+  return (link->Transport == PACKET_TRANSPORT_COBS) ? COBS_MAX_ENCODED_SIZE(ReceivedSize(link)) : ReceivedSize(link);
+}
+
+void Packet_SetTransport(TPacketLink* const link, const TPacketTransport transport)
+{
+  link->Transport = transport;
+
+  // Any partly received frame belongs to the old transport
+  COBS_DecoderInit(&link->COBSDecoder, link->DecodedPacket, sizeof(link->DecodedPacket));
+
+  // Only wake the receiving thread once a whole packet has arrived (or the line goes idle)
+  UART_SetReceiveThreshold(link->UART, ReceivedWireSize(link));
+}
+
+void Packet_SetSequenced(TPacketLink* const link, const bool sequenced)
+{
+  link->Sequenced = sequenced;
+  UART_SetReceiveThreshold(link->UART, ReceivedWireSize(link));
+}
+
+bool Packet_IsAvailable(const TPacketLink* const link)
 {
-  uint8_t data;
-  UART_InChar(&data);
+  return UART_InNbBytes(link->UART) >= ReceivedWireSize(link);
+}
 
-  // Append the internal buffer with the received byte
-  PacketBuf[BufNbBytes] = data;
-  BufNbBytes++;
+TPacketTransport Packet_GetTransport(const TPacketLink* const link)
+{
+  return link->Transport;
 }
 
-/*! @brief Checks if the candidate packet in the buffer is valid
+/*! @brief Append the check bytes to a packet or frame
  *
- *  Verifies the candidate packet in the buffer by comparing the checksum byte
- *  against one calculated for the initial 4 bytes of the packet
+ *  The check is a CRC-16 if PACKET_CRC is defined, otherwise every byte XORed together.
  *
- *  @return BOOL - TRUE if the candidate packet is successful.
+ *  @param bytes The packet or frame, with room for PACKET_CHECK_NB_BYTES after the data.
+ *  @param nbBytes The number of bytes before the check bytes.
  */
-static bool IsChecksumValid(void)
+static void PutCheck(uint8_t bytes[], const uint8_t nbBytes)
 {
-  uint8_t checksum = PacketBuf[0]; // set Initial Value (byte 1) for checksum calculation
+#ifdef PACKET_CRC
+  uint16union_t crc;
+  crc.l = CRC_Calculate16(bytes, nbBytes);
+
+  bytes[nbBytes] = crc.s.Lo;
+  bytes[nbBytes + 1] = crc.s.Hi;
+#else
+  uint8_t checksum = bytes[0]; // set Initial Value (byte 1) for checksum calculation
   uint8_t i;
 
   // Perform checksum calculation
-  for (i = 1; i < (PACKET_SIZE - 1); i++)
+  for (i = 1; i < nbBytes; i++)
   {
-    checksum ^= PacketBuf[i];
+    checksum ^= bytes[i];
   }
 
-  // Check if calculated checksum == received checksum
-  return checksum == PacketBuf[PACKET_SIZE - 1];
+  bytes[nbBytes] = checksum;
+#endif
 }
 
-/*! @brief Discard First Byte In Internal Buffer
-*
-* Drops the first byte in the internal error handling/recovery buffer and maintains buffer state
-*
-*/
-static void ShiftBuffer(void)
+#ifdef PACKET_CRC
+/*! @brief Checks if the candidate packet is valid
+ *
+ *  Verifies the candidate packet by comparing its CRC bytes
+ *  against those calculated for the bytes of the packet before them
+ *
+ *  @param candidate The bytes of the candidate packet.
+ *  @param nbBytes The number of bytes in the candidate packet, including the CRC bytes.
+ *  @return BOOL - TRUE if the candidate packet is successful.
+ */
+static bool IsCheckValid(const uint8_t candidate[], const uint8_t nbBytes)
+{
+  const uint8_t nbDataBytes = nbBytes - PACKET_CHECK_NB_BYTES;
+  uint16union_t crc;
+  crc.l = CRC_Calculate16(candidate, nbDataBytes);
+
+  // Check if calculated CRC == received CRC
+  return crc.s.Lo == candidate[nbDataBytes] && crc.s.Hi == candidate[nbDataBytes + 1];
+}
+#else
+/*! @brief XOR the bytes of a candidate packet together
+ *
+ *  The checksum is the XOR of the bytes before it, so the result is 0 for a valid packet.
+ *
+ *  @param candidate The bytes of the candidate packet.
+ *  @param nbBytes The number of bytes in the candidate packet, including the checksum.
+ *  @return uint8_t - Every byte XORed together.
+ */
+static uint8_t XORBytes(const uint8_t candidate[], const uint8_t nbBytes)
 {
+  uint8_t result = 0;
   uint8_t i;
 
-  // Shift the internal buffer 1 to the left (discard first byte)
-  for (i = 1; i < PACKET_SIZE; i++)
+  for (i = 0; i < nbBytes; i++)
   {
-    PacketBuf[i - 1] = PacketBuf[i];
+    result ^= candidate[i];
   }
 
-  BufNbBytes--;
+  return result;
 }
+#endif
 
-/*! @brief Set Packet Bytes and Reset Internal Buffers
-*
-* Sets the public Packet bytes and resets the internal state used for error handling/recovery
-*
-*/
-static void SetValuesAndResetBuffer(void)
+/*! @brief Gets a packet from a COBS link
+ *
+ *  Every delimiter starts a new frame, so after an error the very next packet is received.
+ *
+ *  @param link The link to receive on.
+ *  @param packet A pointer to store the packet.
+ */
+static void GetCOBS(TPacketLink* const link, TPacket* const packet)
 {
-  // Set the packet bytes from the buffer used during the error checking/handling phase
-  Packet_Command = PacketBuf[0];
-  Packet_Parameter1 = PacketBuf[1];
-  Packet_Parameter2 = PacketBuf[2];
-  Packet_Parameter3 = PacketBuf[3];
+  const uint8_t size = ReceivedSize(link);
 
-  // Reset the error handling buffer index
-  BufNbBytes = 0;
-}
-
-void Packet_Get(void)
-{
-  // Continuously receive bytes until a valid packet is formed
   for (;;)
   {
-    ReadNextByte(); // Blocks until a byte is received
+    // Blocks until a byte is received
+    const uint8_t data = *UART_InPeek(link->UART, 1);
+    UART_InConsume(link->UART, 1);
 
-    // Check if the internal buffer has enough bytes for a packet
-    if (BufNbBytes >= PACKET_SIZE)
+    // Frames of any other length are not packets, and are discarded
+    if (COBS_Decode(&link->COBSDecoder, data) == size)
     {
-      // Check if the candidate (formed) packet is valid
-      if (IsChecksumValid())
+#ifdef PACKET_CRC
+      if (IsCheckValid(link->DecodedPacket, size))
+#else
+      if (XORBytes(link->DecodedPacket, size) == 0)
+#endif
       {
-        // Set the Packet bytes and reset internal error handling/recovery state
-        SetValuesAndResetBuffer();
+        memcpy(packet->bytes, link->DecodedPacket, size - PACKET_CHECK_NB_BYTES);
         return;
       }
-      else
-      {
-        // Candidate packet was invalid
-        // Attempt error recovery by discarding first byte (in preparation for reading another byte)
-        ShiftBuffer();
-      }
     }
   }
 }
 
-bool Packet_Put(const uint8_t command, const uint8_t parameter1,
+void Packet_Get(TPacketLink* const link, TPacket* const packet)
+{
+  if (link->Transport == PACKET_TRANSPORT_COBS)
+  {
+    GetCOBS(link, packet);
+    return;
+  }
+
+  const uint8_t size = ReceivedSize(link);
+
+  // Blocks until a whole candidate packet is received, which is then checked in place in the receive buffer
+  const uint8_t * candidate = UART_InPeek(link->UART, size);
+#ifndef PACKET_CRC
+  uint8_t candidateXOR = XORBytes(candidate, size);
+#endif
+
+  // Continuously slide the candidate along the received bytes until a valid packet is formed
+  for (;;)
+  {
+    // Check if the candidate (formed) packet is valid
+#ifdef PACKET_CRC
+    if (IsCheckValid(candidate, size))
+#else
+    if (candidateXOR == 0)
+#endif
+    {
+      // Set the Packet bytes and release them from the receive buffer
+      memcpy(packet->bytes, candidate, size - PACKET_CHECK_NB_BYTES);
+      UART_InConsume(link->UART, size);
+      return;
+    }
+
+    // Candidate packet was invalid
+    // Attempt error recovery by discarding first byte, and taking in the byte after the candidate.
+    // With the XOR checksum only those two bytes change the running XOR, so each alignment costs the same
+    // however long the line stays noisy
+#ifndef PACKET_CRC
+    candidateXOR ^= candidate[0];
+#endif
+    UART_InConsume(link->UART, 1);
+    candidate = UART_InPeek(link->UART, size);
+#ifndef PACKET_CRC
+    candidateXOR ^= candidate[size - 1];
+#endif
+  }
+}
+
+bool Packet_Register(TPacketLink* const link, const uint8_t command, const TPacketHandler handler, const uint8_t zeroParameters)
+{
+  if (command >= PACKET_NB_COMMANDS || !handler)
+    return false;
+
+  link->Commands[command].Handler = handler;
+  link->Commands[command].ZeroParameters = zeroParameters;
+  return true;
+}
+
+bool Packet_Dispatch(TPacketLink* const link, const TPacket* const packet)
+{
+  TPacketCommand * const entry = &link->Commands[Packet_Command(packet) & ~PACKET_ACK_MASK];
+
+  if (!entry->Handler)
+  {
+    link->NbUnknown++;
+    return false;
+  }
+
+  entry->NbReceived++;
+
+  // Gather the bits of the parameters that are not 0, any of which in the mask fails the packet
+  const uint8_t nonZero = ((Packet_Parameter1(packet) != 0) ? PACKET_PARAMETER1_ZERO : 0)
+      | ((Packet_Parameter2(packet) != 0) ? PACKET_PARAMETER2_ZERO : 0)
+      | ((Packet_Parameter3(packet) != 0) ? PACKET_PARAMETER3_ZERO : 0);
+
+  if ((nonZero & entry->ZeroParameters) || !entry->Handler(link, packet))
+  {
+    entry->NbFailed++;
+    return false;
+  }
+
+  return true;
+}
+
+bool Packet_GetCommandStatistics(const TPacketLink* const link, const uint8_t command, uint32_t* const nbReceived,
+    uint32_t* const nbFailed)
+{
+  if (command >= PACKET_NB_COMMANDS)
+    return false;
+
+  *nbReceived = link->Commands[command].NbReceived;
+  *nbFailed = link->Commands[command].NbFailed;
+  return true;
+}
+
+/*! @brief Transmit a packet or frame that has been built in a transmit slot, COBS encoding it in place on a COBS link
+ *
+ *  @param link The link the slot was reserved on.
+ *  @param txClass The transmit priority class the slot was reserved from.
+ *  @param bytes The slot, holding the packet or frame.
+ *  @param nbBytes The number of bytes in the packet or frame, including the check bytes.
+ */
+static void Commit(TPacketLink* const link, const TUARTTxClass txClass, uint8_t bytes[], const uint8_t nbBytes)
+{
+  if (link->Transport == PACKET_TRANSPORT_COBS)
+  {
+    uint8_t frame[FIFO_SLOT_SIZE];
+
+    memcpy(frame, bytes, nbBytes);
+    UART_OutCommit(link->UART, txClass, bytes, (uint8_t) COBS_Encode(frame, nbBytes, bytes));
+  }
+  else
+  {
+    UART_OutCommit(link->UART, txClass, bytes, nbBytes);
+  }
+}
+
+bool Packet_Put(TPacketLink* const link, const uint8_t command, const uint8_t parameter1,
+    const uint8_t parameter2, const uint8_t parameter3)
+{
+  return Packet_PutPriority(link, UART_TX_CONTROL, command, parameter1, parameter2, parameter3);
+}
+
+bool Packet_PutPriority(TPacketLink* const link, const TUARTTxClass txClass, const uint8_t command, const uint8_t parameter1,
     const uint8_t parameter2, const uint8_t parameter3)
 {
-  // Calculate check sum
-  uint8_t checkSum = command ^ parameter1 ^ parameter2 ^ parameter3;
+  // Several threads may send at once. Each claims its own slot in the transmit buffer,
+  // so packets are never interleaved and no lock is needed.
+  // If the link has stalled, drop the packet rather than holding up the calling thread.
+  uint8_t * const bytes = UART_OutReserve(link->UART, txClass, PACKET_PUT_TIMEOUT);
 
-  // We could be interrupted by RTC, which may push a packet
-  // through half way through transmitting this one
-  OS_SemaphoreWait(PutMutex, 0);
+  if (!bytes)
+    return false;
 
-  // Transmit the packet bytes
-  const bool wasSuccess = UART_OutChar(command) &&
-      UART_OutChar(parameter1) &&
-      UART_OutChar(parameter2) &&
-      UART_OutChar(parameter3) &&
-      UART_OutChar(checkSum);
+  // Build the packet straight into the transmit buffer, calculating the check bytes
+  bytes[0] = command;
+  bytes[1] = parameter1;
+  bytes[2] = parameter2;
+  bytes[3] = parameter3;
+  PutCheck(bytes, PACKET_NB_DATA_BYTES);
 
-  OS_SemaphoreSignal(PutMutex);
+  // Transmit the whole packet at once
+  Commit(link, txClass, bytes, PACKET_SIZE);
 
-  return wasSuccess;
+  return true;
+}
+
+bool Packet_PutFrame(TPacketLink* const link, const TUARTTxClass txClass, const uint8_t command, const uint8_t * const payload, const uint8_t nbBytes)
+{
+  // A frame is only kept together on the wire if it fits in one slot
+  if (nbBytes > PACKET_FRAME_MAX_PAYLOAD)
+    return false;
+
+  uint8_t * const bytes = UART_OutReserve(link->UART, txClass, PACKET_PUT_TIMEOUT);
+
+  if (!bytes)
+    return false;
+
+  // Build the frame straight into the transmit buffer, calculating the check bytes
+  bytes[0] = command;
+  memcpy(&bytes[1], payload, nbBytes);
+  PutCheck(bytes, nbBytes + 1);
+
+  // Transmit the whole frame at once
+  Commit(link, txClass, bytes, nbBytes + 1 + PACKET_CHECK_NB_BYTES);
+
+  return true;
+}
+
+/*! @brief Sends a 32-bit UART statistic as two "UART - Statistics" packets, the low half first.
+ *
+ *  @param link The link to send on.
+ *  @param statisticNb The statistic being sent, the high half is sent as statisticNb + 1.
+ *  @param value The value of the statistic.
+ *  @return bool - TRUE if both packets were sent.
+ */
+static bool PutUARTStatistic(TPacketLink* const link, const TPacketUARTStatistic statisticNb, const uint32_t value)
+{
+  uint32union_t valueParts;
+  uint16union_t halfParts;
+  valueParts.l = value;
+
+  halfParts.l = valueParts.s.Lo;
+  if (!Packet_Put(link, PACKET_COMMAND_UART_STATISTICS, statisticNb, halfParts.s.Lo, halfParts.s.Hi))
+    return false;
+
+  halfParts.l = valueParts.s.Hi;
+  return Packet_Put(link, PACKET_COMMAND_UART_STATISTICS, statisticNb + 1, halfParts.s.Lo, halfParts.s.Hi);
+}
+
+bool Packet_PutUARTStatistics(TPacketLink* const link)
+{
+  TUARTStatistics statistics;
+
+  // One snapshot, so the values agree with each other, and not the packets sending them
+  UART_GetStatistics(link->UART, &statistics);
+
+  return PutUARTStatistic(link, UART_STATISTIC_NB_RX_BYTES, statistics.NbRxBytes)
+      && PutUARTStatistic(link, UART_STATISTIC_NB_TX_BYTES, statistics.NbTxBytes)
+      && PutUARTStatistic(link, UART_STATISTIC_NB_OVERRUNS, statistics.NbOverruns)
+      && PutUARTStatistic(link, UART_STATISTIC_NB_NOISE_ERRORS, statistics.NbNoiseErrors)
+      && PutUARTStatistic(link, UART_STATISTIC_NB_FRAMING_ERRORS, statistics.NbFramingErrors)
+      && PutUARTStatistic(link, UART_STATISTIC_NB_PARITY_ERRORS, statistics.NbParityErrors)
+      && PutUARTStatistic(link, UART_STATISTIC_NB_RX_UNDERFLOWS, statistics.NbRxUnderflows)
+      && PutUARTStatistic(link, UART_STATISTIC_NB_TX_OVERFLOWS, statistics.NbTxOverflows)
+      && PutUARTStatistic(link, UART_STATISTIC_NB_INTERRUPTS, statistics.NbInterrupts)
+      && PutUARTStatistic(link, UART_STATISTIC_MIN_ISR_CYCLES, statistics.MinISRCycles)
+      && PutUARTStatistic(link, UART_STATISTIC_AVG_ISR_CYCLES,
+          (statistics.NbInterrupts != 0) ? (uint32_t) (statistics.TotalISRCycles / statistics.NbInterrupts) : 0)
+      && PutUARTStatistic(link, UART_STATISTIC_MAX_ISR_CYCLES, statistics.MaxISRCycles);
+}
+
+/*! @brief Handles the "UART - Statistics" packet.
+ *
+ *  @param link The link the packet was received on.
+ *  @param packet The received packet.
+ *  @return bool - TRUE if the statistics were sent.
+ */
+static bool HandleUARTStatistics(TPacketLink* const link, const TPacket* const packet)
+{
+  (void) packet;
+
+  return Packet_PutUARTStatistics(link);
+}
+
+bool Packet_RegisterCommands(TPacketLink* const link)
+{
+  return Packet_Register(link, PACKET_COMMAND_UART_STATISTICS, HandleUARTStatistics, PACKET_PARAMETERS_ZERO);
 }
 
 /*!
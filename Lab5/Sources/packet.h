@@ -3,6 +3,9 @@
  *  @brief Routines to implement packet encoding and decoding for the serial port.
  *
  *  This contains the functions for implementing the "Tower to PC Protocol" 5-byte packets.
+ *  On a COBS link each packet or frame is instead byte stuffed by COBS_Encode and ends with a 0x00 delimiter,
+ *  so the PC finds its boundaries (and its length) without searching for a valid check.
+ *  On a sequenced link the packets from the PC carry a sequence number after the parameters.
  *
  *  @author PMcL
  *  @date 2015-07-23
@@ -13,10 +16,73 @@
 
 // New types
 #include "types.h"
+#include "UART.h"
+#include "COBS.h"
 
 // Packet structure
 #define PACKET_NB_BYTES 5
 
+// Uncommenting the below checks packets and frames with a CRC-16 (sent LSB first) rather than a 1 byte XOR checksum,
+// which also catches swapped bytes and most burst errors. The PC must then check them the same way
+//#define PACKET_CRC
+
+#ifdef PACKET_CRC
+#define PACKET_CHECK_NB_BYTES 2
+#else
+#define PACKET_CHECK_NB_BYTES 1
+#endif
+
+// The command and parameters, followed by the check bytes
+#define PACKET_NB_DATA_BYTES 4
+#define PACKET_SIZE (PACKET_NB_DATA_BYTES + PACKET_CHECK_NB_BYTES)
+
+// A packet from the PC on a sequenced link, with its sequence number before the check bytes
+#define PACKET_SEQUENCED_SIZE (PACKET_SIZE + 1)
+
+// Bytes COBS adds to a packet or frame of less than 254 bytes, its code byte and delimiter
+#define PACKET_COBS_NB_BYTES 2
+
+// Largest payload of a frame, which is sent whole in one transmit slot after its command byte and before its check bytes,
+// with room to spare for the COBS overhead so it is the same on either transport
+#define PACKET_FRAME_MAX_PAYLOAD (FIFO_SLOT_SIZE - 1 - PACKET_CHECK_NB_BYTES - PACKET_COBS_NB_BYTES)
+
+/*!
+ * @enum TPacketTransport
+ *
+ * How packets and frames are delimited on the link.
+ */
+typedef enum
+{
+  PACKET_TRANSPORT_RAW = 0,  /*!< Back to back, found by sliding along the received bytes until the check is valid */
+  PACKET_TRANSPORT_COBS = 1  /*!< COBS encoded, each ended by a 0x00 delimiter */
+} TPacketTransport;
+
+// "UART - Statistics" Command, registered by Packet_RegisterCommands
+#define PACKET_COMMAND_UART_STATISTICS 0x32
+
+/*!
+ * @enum TPacketUARTStatistic
+ *
+ * The statistics reported by the "UART - Statistics" Command, in parameter 1.
+ * Every statistic is 32 bits, sent as two values, the low half first.
+ */
+typedef enum
+{
+  UART_STATISTIC_NB_RX_BYTES = 0,        /*!< Bytes received (0 = low, 1 = high) */
+  UART_STATISTIC_NB_TX_BYTES = 2,        /*!< Bytes transmitted (2 = low, 3 = high) */
+  UART_STATISTIC_NB_OVERRUNS = 4,        /*!< Overrun errors (4 = low, 5 = high) */
+  UART_STATISTIC_NB_NOISE_ERRORS = 6,    /*!< Noise errors (6 = low, 7 = high) */
+  UART_STATISTIC_NB_FRAMING_ERRORS = 8,  /*!< Framing errors (8 = low, 9 = high) */
+  UART_STATISTIC_NB_PARITY_ERRORS = 10,  /*!< Parity errors (10 = low, 11 = high) */
+  UART_STATISTIC_NB_RX_UNDERFLOWS = 12,  /*!< Hardware receive FIFO underflows (12 = low, 13 = high) */
+  UART_STATISTIC_NB_TX_OVERFLOWS = 14,   /*!< Hardware transmit FIFO overflows (14 = low, 15 = high) */
+  UART_STATISTIC_NB_INTERRUPTS = 16,     /*!< Interrupts serviced (16 = low, 17 = high) */
+  UART_STATISTIC_MIN_ISR_CYCLES = 18,    /*!< Fewest CPU cycles in the ISR (18 = low, 19 = high) */
+  UART_STATISTIC_AVG_ISR_CYCLES = 20,    /*!< Average CPU cycles in the ISR, rounded down (20 = low, 21 = high) */
+  UART_STATISTIC_MAX_ISR_CYCLES = 22,    /*!< Most CPU cycles in the ISR (22 = low, 23 = high) */
+  UART_STATISTIC_NB_PACKETS = 24         /*!< The number of packets in a reply, two for each statistic */
+} TPacketUARTStatistic;
+
 #pragma pack(push)
 #pragma pack(1)
 
@@ -45,21 +111,75 @@ typedef union
         uint16_t parameter23;         /*!< Parameter 2 and 3 concatenated. */
       } combined23;
     } parameters;
-    uint8_t checksum;
+    union
+    {
+      uint8_t checksum;       /*!< The packet's checksum. */
+      uint8_t sequenceNb;     /*!< The packet's sequence number, on a sequenced link. */
+    } trailer;
   } packetStruct;
 } TPacket;
 
 #pragma pack(pop)
 
-#define Packet_Command     Packet.packetStruct.command
-#define Packet_Parameter1  Packet.packetStruct.parameters.separate.parameter1
-#define Packet_Parameter2  Packet.packetStruct.parameters.separate.parameter2
-#define Packet_Parameter3  Packet.packetStruct.parameters.separate.parameter3
-#define Packet_Parameter12 Packet.packetStruct.parameters.combined12.parameter12
-#define Packet_Parameter23 Packet.packetStruct.parameters.combined23.parameter23
-#define Packet_Checksum    Packet.packetStruct.checksum
+// The fields of a packet, given a pointer to it
+#define Packet_Command(packet)     ((packet)->packetStruct.command)
+#define Packet_Parameter1(packet)  ((packet)->packetStruct.parameters.separate.parameter1)
+#define Packet_Parameter2(packet)  ((packet)->packetStruct.parameters.separate.parameter2)
+#define Packet_Parameter3(packet)  ((packet)->packetStruct.parameters.separate.parameter3)
+#define Packet_Parameter12(packet) ((packet)->packetStruct.parameters.combined12.parameter12)
+#define Packet_Parameter23(packet) ((packet)->packetStruct.parameters.combined23.parameter23)
+#define Packet_Checksum(packet)    ((packet)->packetStruct.trailer.checksum)
+#define Packet_SequenceNb(packet)  ((packet)->packetStruct.trailer.sequenceNb)
+
+// Number of commands, as bit 7 of the command byte is the acknowledgement request
+#define PACKET_NB_COMMANDS 128
 
-extern TPacket Packet;
+// Bits of a command's validation mask, for each parameter that must be 0
+#define PACKET_PARAMETER1_ZERO 0x01
+#define PACKET_PARAMETER2_ZERO 0x02
+#define PACKET_PARAMETER3_ZERO 0x04
+#define PACKET_PARAMETERS_ZERO (PACKET_PARAMETER1_ZERO | PACKET_PARAMETER2_ZERO | PACKET_PARAMETER3_ZERO)
+
+// A protocol instance, defined below
+typedef struct PacketLink TPacketLink;
+
+/*! @brief Handles a received packet.
+ *
+ *  @param link The link the packet was received on, for the handler to respond on.
+ *  @param packet The received packet, with parameters that have passed its command's validation mask.
+ *  @return bool - TRUE if the packet was successfully handled.
+ */
+typedef bool (*TPacketHandler)(TPacketLink* const link, const TPacket* const packet);
+
+/*!
+ * @struct TPacketCommand
+ *
+ * A command's entry in a link's dispatch table.
+ */
+typedef struct
+{
+  TPacketHandler Handler;     /*!< The command's handler, NULL if the command is not registered */
+  uint8_t ZeroParameters;     /*!< The PACKET_PARAMETERn_ZERO bits of the parameters that must be 0 */
+  uint32_t NbReceived;        /*!< Packets received with the command */
+  uint32_t NbFailed;          /*!< Packets received with the command that failed validation or were not handled */
+} TPacketCommand;
+
+/*!
+ * @struct TPacketLink
+ *
+ * A protocol instance, running on one UART. The fields are private to the packet module.
+ * Any number of threads may send on a link at once, but only one thread may receive on it.
+ */
+struct PacketLink
+{
+  TUART* UART;                          /*!< The UART instance the packets are sent and received on */
+  TPacketTransport Transport;           /*!< How packets and frames are delimited on the link */
+  bool Sequenced;                       /*!< TRUE if the packets from the PC carry a sequence number */
+  uint8_t DecodedPacket[PACKET_SEQUENCED_SIZE]; /*!< The packet decoded by COBSDecoder */
+  TCOBSDecoder COBSDecoder;             /*!< Decodes the received bytes on a COBS link */
+  TPacketCommand Commands[PACKET_NB_COMMANDS]; /*!< The dispatch table, indexed by the command without its acknowledgement bit */
+  uint32_t NbUnknown;                   /*!< Packets received with a command that is not registered */
+};
 
 // Acknowledgment bit mask
 extern const uint8_t PACKET_ACK_MASK;
@@ -67,23 +187,150 @@ extern const uint8_t PACKET_ACK_MASK;
 /*! @brief Initializes the packets by calling the initialization routines of the
  * supporting software modules.
  *
+ *  @param link The link to set up.
+ *  @param uart The UART instance the packets are sent and received on.
  *  @param baudRate The desired baud rate in bits/sec.
  *  @param moduleClk The module clock rate in Hz.
  *  @return bool - TRUE if the packet module was successfully initialized.
  */
-bool Packet_Init(const uint32_t baudRate, const uint32_t moduleClk);
+bool Packet_Init(TPacketLink* const link, TUART* const uart, const uint32_t baudRate, const uint32_t moduleClk);
+
+/*! @brief Changes how packets and frames are delimited on the link, which starts as PACKET_TRANSPORT_RAW.
+ *
+ *  Packets already placed in the transmit FIFO are sent as they were built.
+ *
+ *  @param link The link.
+ *  @param transport The new transport.
+ *  @note Only call this from the thread that calls Packet_Get, between packets.
+ */
+void Packet_SetTransport(TPacketLink* const link, const TPacketTransport transport);
+
+/*! @brief Gets how packets and frames are delimited on the link.
+ *
+ *  @param link The link.
+ *  @return TPacketTransport - The current transport.
+ */
+TPacketTransport Packet_GetTransport(const TPacketLink* const link);
+
+/*! @brief Changes whether the packets from the PC carry a sequence number, which they start without.
+ *
+ *  The packets sent to the PC are unchanged.
+ *
+ *  @param link The link.
+ *  @param sequenced TRUE for packets of PACKET_SEQUENCED_SIZE, FALSE for packets of PACKET_SIZE.
+ *  @note Only call this from the thread that calls Packet_Get, between packets.
+ */
+void Packet_SetSequenced(TPacketLink* const link, const bool sequenced);
+
+/*! @brief Checks whether enough bytes have been received for another packet.
+ *
+ *  @param link The link.
+ *  @return bool - TRUE if Packet_Get can get a packet without waiting for more bytes, unless some were corrupted.
+ */
+bool Packet_IsAvailable(const TPacketLink* const link);
 
 /*! @brief Attempts to get a packet from the received data.
  *
+ *  The packet belongs to the caller, so it can be handled while the next one is received into another.
+ *
+ *  @param link The link to receive on.
+ *  @param packet A pointer to store the packet's command and parameters, and its sequence number on a sequenced link.
  * @note This method will block until a packet is found
  */
-void Packet_Get(void);
+void Packet_Get(TPacketLink* const link, TPacket* const packet);
+
+/*! @brief Registers the handler of a command, replacing any already registered.
+ *
+ *  Any module may register the commands it implements, before the link starts receiving,
+ *  typically from its own Module_RegisterCommands function.
+ *
+ *  @param link The link to receive the command on.
+ *  @param command The command, without its acknowledgement bit.
+ *  @param handler The command's handler.
+ *  @param zeroParameters The PACKET_PARAMETERn_ZERO bits of the parameters that must be 0,
+ *                        packets where they are not fail without calling the handler.
+ *  @return bool - TRUE if the command was registered, FALSE if it is out of range or handler is NULL.
+ */
+bool Packet_Register(TPacketLink* const link, const uint8_t command, const TPacketHandler handler, const uint8_t zeroParameters);
+
+/*! @brief Handles a received packet with the handler registered for its command.
+ *
+ *  The handler is found by indexing the dispatch table, so it costs the same for every command.
+ *
+ *  @param link The link the packet was received on.
+ *  @param packet The received packet.
+ *  @return bool - TRUE if the packet was successfully handled, FALSE if it failed, or its command is not registered.
+ */
+bool Packet_Dispatch(TPacketLink* const link, const TPacket* const packet);
+
+/*! @brief Gets the counters of a command.
+ *
+ *  @param link The link.
+ *  @param command The command, without its acknowledgement bit.
+ *  @param nbReceived A pointer to store the number of packets received with the command.
+ *  @param nbFailed A pointer to store how many of them failed.
+ *  @return bool - TRUE if the command is in range.
+ */
+bool Packet_GetCommandStatistics(const TPacketLink* const link, const uint8_t command, uint32_t* const nbReceived,
+    uint32_t* const nbFailed);
+
+/*! @brief Builds a packet and places it in the control transmit FIFO buffer.
+ *
+ *  @param link The link to send on.
+ *  @return bool - TRUE if a valid packet was sent, FALSE if it was dropped because the transmitter is backed up.
+ * @note This method will block until the packet has been placed in the output buffer, or a short timeout expires
+ */
+bool Packet_Put(TPacketLink* const link, const uint8_t command, const uint8_t parameter1, const uint8_t parameter2, const uint8_t parameter3);
+
+/*! @brief Builds a packet and places it in the transmit FIFO buffer of a priority class.
+ *
+ *  @param link The link to send on.
+ *  @param txClass The transmit priority class, e.g. UART_TX_TELEMETRY for periodic data.
+ *  @return bool - TRUE if a valid packet was sent, FALSE if it was dropped because the transmitter is backed up.
+ * @note This method will block until the packet has been placed in the output buffer, or a short timeout expires
+ */
+bool Packet_PutPriority(TPacketLink* const link, const TUARTTxClass txClass, const uint8_t command, const uint8_t parameter1,
+    const uint8_t parameter2, const uint8_t parameter3);
+
+/*! @brief Builds a variable length frame and places it in the transmit FIFO buffer of a priority class.
+ *
+ *  The frame is the command byte, the payload, then the check bytes of every preceding byte, as for a packet.
+ *  The payload must start with enough for the PC to work out its length from the command.
+ *
+ *  @param link The link to send on.
+ *  @param txClass The transmit priority class, e.g. UART_TX_TELEMETRY for periodic data.
+ *  @param command The frame's command.
+ *  @param payload The bytes following the command.
+ *  @param nbBytes The number of bytes in the payload, no greater than PACKET_FRAME_MAX_PAYLOAD.
+ *  @return bool - TRUE if the frame was sent, FALSE if it was dropped because the transmitter is backed up.
+ * @note This method will block until the frame has been placed in the output buffer, or a short timeout expires
+ */
+bool Packet_PutFrame(TPacketLink* const link, const TUARTTxClass txClass, const uint8_t command, const uint8_t* const payload, const uint8_t nbBytes);
 
-/*! @brief Builds a packet and places it in the transmit FIFO buffer.
+/*! @brief Sends the statistics of the link's UART as "UART - Statistics" packets.
+ *
+ *  Command: 0x32
+ *  Parameter 1: TPacketUARTStatistic number (the statistic for the low half, the statistic + 1 for the high half)
+ *  Parameter 2: LSB
+ *  Parameter 3: MSB
+ *
+ *  Every TPacketUARTStatistic is sent as two packets, the low half first, from one UART_GetStatistics snapshot.
+ *  The PC rebuilds each value as (high packet's MSB:LSB << 16) | (low packet's MSB:LSB),
+ *  and can find the throughput and error rates from the change between requests.
+ *  The ISR cycle counts are in core clock cycles (CPU_CORE_CLK_HZ).
+ *
+ *  @param link The link to send on, and whose UART the statistics are of.
+ *  @return bool - TRUE if every packet was sent.
+ */
+bool Packet_PutUARTStatistics(TPacketLink* const link);
+
+/*! @brief Registers the handler of the "UART - Statistics" command on a link.
+ *
+ *  The command has all 3 parameters 0, and is answered by Packet_PutUARTStatistics.
  *
- *  @return bool - TRUE if a valid packet was sent.
- * @note This method will block until the packet has been successfully placed in the output buffer
+ *  @param link The link to receive the command on.
+ *  @return bool - TRUE if the command was registered.
  */
-bool Packet_Put(const uint8_t command, const uint8_t parameter1, const uint8_t parameter2, const uint8_t parameter3);
+bool Packet_RegisterCommands(TPacketLink* const link);
 
 #endif